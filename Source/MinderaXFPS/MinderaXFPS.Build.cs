@@ -15,6 +15,7 @@ public class MinderaXFPS : ModuleRules
 				"Core", 
 				"CoreUObject",
 				"Engine", 
+				"GameplayTasks",
 			//	"EnhancedInput",
 				"InputCore",
 				"NavigationSystem",
@@ -0,0 +1,59 @@
+// Ricardo Santos, 2023
+
+#include "Behaviors/BTDecorator_CanStalkerMove.h"
+
+#include <BehaviorTree/BehaviorTreeComponent.h>
+
+#include "Controllers/StalkerAIController.h"
+
+UBTDecorator_CanStalkerMove::UBTDecorator_CanStalkerMove(FObjectInitializer const& ObjectInitializer)
+	: Super{ ObjectInitializer }
+{
+	NodeName = TEXT("Can Stalker Move");
+
+	// The node isn't instanced, the binding of each tree lives in its memory instead
+	bNotifyBecomeRelevant = true;
+	bNotifyCeaseRelevant = true;
+
+	FlowAbortMode = EBTFlowAbortMode::Self;
+}
+
+bool UBTDecorator_CanStalkerMove::CalculateRawConditionValue(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) const
+{
+	AStalkerAIController const* Controller = Cast<AStalkerAIController>(OwnerComp.GetAIOwner());
+	return Controller && Controller->CanExecuteMoveTo();
+}
+
+uint16 UBTDecorator_CanStalkerMove::GetInstanceMemorySize() const
+{
+	return sizeof(FCanStalkerMoveMemory);
+}
+
+void UBTDecorator_CanStalkerMove::OnBecomeRelevant(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	if (AStalkerAIController* Controller = Cast<AStalkerAIController>(OwnerComp.GetAIOwner()))
+	{
+		FCanStalkerMoveMemory* Memory = CastInstanceNodeMemory<FCanStalkerMoveMemory>(NodeMemory);
+		Memory->CanMoveChangedHandle = Controller->OnCanMoveChangedNative.AddUObject(this, &UBTDecorator_CanStalkerMove::HandleCanMoveChanged,
+																					 MakeWeakObjectPtr(&OwnerComp));
+	}
+}
+
+void UBTDecorator_CanStalkerMove::OnCeaseRelevant(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	FCanStalkerMoveMemory* Memory = CastInstanceNodeMemory<FCanStalkerMoveMemory>(NodeMemory);
+	if (AStalkerAIController* Controller = Cast<AStalkerAIController>(OwnerComp.GetAIOwner()))
+	{
+		Controller->OnCanMoveChangedNative.Remove(Memory->CanMoveChangedHandle);
+	}
+
+	Memory->CanMoveChangedHandle.Reset();
+}
+
+void UBTDecorator_CanStalkerMove::HandleCanMoveChanged(bool bCanMove, TWeakObjectPtr<UBehaviorTreeComponent> OwnerComp) const
+{
+	if (UBehaviorTreeComponent* BehaviorComp = OwnerComp.Get())
+	{
+		ConditionalFlowAbort(*BehaviorComp, EBTDecoratorAbortRequest::ConditionResultChanged);
+	}
+}
@@ -0,0 +1,67 @@
+// Ricardo Santos, 2023
+
+#include "Behaviors/BTDecorator_ShouldRunBehaviors.h"
+
+#include <BehaviorTree/BehaviorTreeComponent.h>
+
+#include "GameFramework/MXFPSGameModeBase.h"
+
+namespace
+{
+	AMXFPSGameModeBase* GetGameMode(UBehaviorTreeComponent const& OwnerComp)
+	{
+		UWorld const* World = OwnerComp.GetWorld();
+		return World ? World->GetAuthGameMode<AMXFPSGameModeBase>() : nullptr;
+	}
+}
+
+UBTDecorator_ShouldRunBehaviors::UBTDecorator_ShouldRunBehaviors(FObjectInitializer const& ObjectInitializer)
+	: Super{ ObjectInitializer }
+{
+	NodeName = TEXT("Should Run Behaviors");
+
+	bNotifyBecomeRelevant = true;
+	bNotifyCeaseRelevant = true;
+
+	FlowAbortMode = EBTFlowAbortMode::Self;
+}
+
+bool UBTDecorator_ShouldRunBehaviors::CalculateRawConditionValue(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) const
+{
+	AMXFPSGameModeBase const* GameMode = GetGameMode(OwnerComp);
+	return GameMode && GameMode->IsGameRunning();
+}
+
+uint16 UBTDecorator_ShouldRunBehaviors::GetInstanceMemorySize() const
+{
+	return sizeof(FShouldRunBehaviorsMemory);
+}
+
+void UBTDecorator_ShouldRunBehaviors::OnBecomeRelevant(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	if (AMXFPSGameModeBase* GameMode = GetGameMode(OwnerComp))
+	{
+		FShouldRunBehaviorsMemory* Memory = CastInstanceNodeMemory<FShouldRunBehaviorsMemory>(NodeMemory);
+		Memory->GameRunningChangedHandle = GameMode->OnGameRunningChangedNative.AddUObject(this, &UBTDecorator_ShouldRunBehaviors::HandleGameRunningChanged,
+																						  MakeWeakObjectPtr(&OwnerComp));
+	}
+}
+
+void UBTDecorator_ShouldRunBehaviors::OnCeaseRelevant(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	FShouldRunBehaviorsMemory* Memory = CastInstanceNodeMemory<FShouldRunBehaviorsMemory>(NodeMemory);
+	if (AMXFPSGameModeBase* GameMode = GetGameMode(OwnerComp))
+	{
+		GameMode->OnGameRunningChangedNative.Remove(Memory->GameRunningChangedHandle);
+	}
+
+	Memory->GameRunningChangedHandle.Reset();
+}
+
+void UBTDecorator_ShouldRunBehaviors::HandleGameRunningChanged(bool bIsGameRunning, TWeakObjectPtr<UBehaviorTreeComponent> OwnerComp) const
+{
+	if (UBehaviorTreeComponent* BehaviorComp = OwnerComp.Get())
+	{
+		ConditionalFlowAbort(*BehaviorComp, EBTDecoratorAbortRequest::ConditionResultChanged);
+	}
+}
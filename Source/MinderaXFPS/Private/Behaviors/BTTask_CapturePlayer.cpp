@@ -0,0 +1,30 @@
+// Ricardo Santos, 2023
+
+#include "Behaviors/BTTask_CapturePlayer.h"
+
+#include <AIController.h>
+#include <BehaviorTree/BehaviorTreeComponent.h>
+
+#include "GameFramework/MXFPSGameModeBase.h"
+
+UBTTask_CapturePlayer::UBTTask_CapturePlayer(FObjectInitializer const& ObjectInitializer)
+	: Super{ ObjectInitializer }
+{
+	NodeName = TEXT("Capture Player");
+}
+
+EBTNodeResult::Type UBTTask_CapturePlayer::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	AAIController* Controller = OwnerComp.GetAIOwner();
+	AMXFPSGameModeBase* GameMode = OwnerComp.GetWorld()->GetAuthGameMode<AMXFPSGameModeBase>();
+
+	// Another stalker might have gotten there first, in the same frame
+	if (!Controller || !GameMode || !GameMode->IsGameRunning())
+	{
+		return EBTNodeResult::Failed;
+	}
+
+	GameMode->ExecuteGameOver(Controller, bShouldRestartGame);
+
+	return EBTNodeResult::Succeeded;
+}
@@ -0,0 +1,112 @@
+// Ricardo Santos, 2023
+
+#include "Behaviors/BTTask_FindPlayer.h"
+
+#include <BehaviorTree/BehaviorTreeComponent.h>
+#include <BehaviorTree/BlackboardComponent.h>
+#include <BehaviorTree/Blackboard/BlackboardKeyType_Object.h>
+
+#include "Controllers/StalkerAIController.h"
+
+UBTTask_FindPlayer::UBTTask_FindPlayer(FObjectInitializer const& ObjectInitializer)
+	: Super{ ObjectInitializer }
+{
+	NodeName = TEXT("Find Player");
+
+	// Only relevant while following the flow field, otherwise the task finishes right away
+	bNotifyTick = true;
+	bNotifyTaskFinished = true;
+
+	BlackboardKey.AddObjectFilter(this, GET_MEMBER_NAME_CHECKED(UBTTask_FindPlayer, BlackboardKey), APawn::StaticClass());
+}
+
+EBTNodeResult::Type UBTTask_FindPlayer::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	AAIController* Controller = OwnerComp.GetAIOwner();
+	APawn const* ControlledPawn = Controller ? Controller->GetPawn() : nullptr;
+	UBlackboardComponent* Blackboard = OwnerComp.GetBlackboardComponent();
+	if (!ControlledPawn || !Blackboard)
+	{
+		return EBTNodeResult::Failed;
+	}
+
+	FVector const Location = ControlledPawn->GetActorLocation();
+
+	APawn* ClosestPlayerPawn = nullptr;
+	double ClosestDistanceSquared = TNumericLimits<double>::Max();
+	for (auto PlayerIter = OwnerComp.GetWorld()->GetPlayerControllerIterator(); PlayerIter; ++PlayerIter)
+	{
+		APawn* PlayerPawn = PlayerIter->IsValid() ? (*PlayerIter)->GetPawn() : nullptr;
+		if (!PlayerPawn)
+		{
+			continue;
+		}
+
+		double const DistanceSquared = FVector::DistSquared(Location, PlayerPawn->GetActorLocation());
+		if (DistanceSquared < ClosestDistanceSquared)
+		{
+			ClosestPlayerPawn = PlayerPawn;
+			ClosestDistanceSquared = DistanceSquared;
+		}
+	}
+
+	if (!ClosestPlayerPawn)
+	{
+		return EBTNodeResult::Failed;
+	}
+
+	Blackboard->SetValue<UBlackboardKeyType_Object>(BlackboardKey.GetSelectedKeyID(), ClosestPlayerPawn);
+
+	if (bShouldFollowFlowField)
+	{
+		if (AStalkerAIController* StalkerController = Cast<AStalkerAIController>(Controller))
+		{
+			StalkerController->FollowFlowFieldTo(ClosestPlayerPawn);
+			return EBTNodeResult::InProgress;
+		}
+	}
+
+	return EBTNodeResult::Succeeded;
+}
+
+EBTNodeResult::Type UBTTask_FindPlayer::AbortTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	if (AStalkerAIController* StalkerController = Cast<AStalkerAIController>(OwnerComp.GetAIOwner()))
+	{
+		StalkerController->StopFollowingFlowField();
+	}
+
+	return EBTNodeResult::Aborted;
+}
+
+void UBTTask_FindPlayer::TickTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float const DeltaSeconds)
+{
+	AStalkerAIController const* StalkerController = Cast<AStalkerAIController>(OwnerComp.GetAIOwner());
+	APawn const* ControlledPawn = StalkerController ? StalkerController->GetPawn() : nullptr;
+	UBlackboardComponent const* Blackboard = OwnerComp.GetBlackboardComponent();
+	AActor const* PlayerPawn = Blackboard ? Cast<AActor>(Blackboard->GetValue<UBlackboardKeyType_Object>(BlackboardKey.GetSelectedKeyID())) : nullptr;
+
+	// Something else stopped the stalker, or the player is gone
+	if (!ControlledPawn || !PlayerPawn || !StalkerController->IsFollowingFlowField())
+	{
+		FinishLatentTask(OwnerComp, EBTNodeResult::Failed);
+		return;
+	}
+
+	if (FVector::DistSquared(ControlledPawn->GetActorLocation(), PlayerPawn->GetActorLocation()) <= FMath::Square(AcceptanceRadius))
+	{
+		FinishLatentTask(OwnerComp, EBTNodeResult::Succeeded);
+	}
+}
+
+void UBTTask_FindPlayer::OnTaskFinished(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTNodeResult::Type const TaskResult)
+{
+	// Nothing else would stop the stalker from following once the tree moves on
+	AStalkerAIController* StalkerController = Cast<AStalkerAIController>(OwnerComp.GetAIOwner());
+	if (StalkerController && StalkerController->IsFollowingFlowField())
+	{
+		StalkerController->StopFollowingFlowField();
+	}
+
+	Super::OnTaskFinished(OwnerComp, NodeMemory, TaskResult);
+}
@@ -0,0 +1,39 @@
+// Ricardo Santos, 2023
+
+#include "Behaviors/BTTask_FindRandomSpot.h"
+
+#include <AIController.h>
+#include <NavigationSystem.h>
+#include <BehaviorTree/BehaviorTreeComponent.h>
+#include <BehaviorTree/BlackboardComponent.h>
+#include <BehaviorTree/Blackboard/BlackboardKeyType_Vector.h>
+
+UBTTask_FindRandomSpot::UBTTask_FindRandomSpot(FObjectInitializer const& ObjectInitializer)
+	: Super{ ObjectInitializer }
+{
+	NodeName = TEXT("Find Random Spot");
+
+	BlackboardKey.AddVectorFilter(this, GET_MEMBER_NAME_CHECKED(UBTTask_FindRandomSpot, BlackboardKey));
+}
+
+EBTNodeResult::Type UBTTask_FindRandomSpot::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	AAIController const* Controller = OwnerComp.GetAIOwner();
+	APawn const* ControlledPawn = Controller ? Controller->GetPawn() : nullptr;
+	UBlackboardComponent* Blackboard = OwnerComp.GetBlackboardComponent();
+	UNavigationSystemV1 const* NavigationSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(OwnerComp.GetWorld());
+	if (!ControlledPawn || !Blackboard || !NavigationSystem)
+	{
+		return EBTNodeResult::Failed;
+	}
+
+	FNavLocation NavLocation;
+	if (!NavigationSystem->GetRandomReachablePointInRadius(ControlledPawn->GetActorLocation(), SearchRadius, NavLocation))
+	{
+		return EBTNodeResult::Failed;
+	}
+
+	Blackboard->SetValue<UBlackboardKeyType_Vector>(BlackboardKey.GetSelectedKeyID(), NavLocation.Location);
+
+	return EBTNodeResult::Succeeded;
+}
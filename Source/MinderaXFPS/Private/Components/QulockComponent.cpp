@@ -3,15 +3,31 @@
 #include "Components/QulockComponent.h"
 
 #include <EngineUtils.h>
-
+#include <GameFramework/GameModeBase.h>
+
+#include "Components/QulockFrameCapture.h"
+#include "Components/QulockInstrumentation.h"
+#include "Components/QulockSupportVertexKernel.h"
+#include "GameFramework/MXFPSGameModeBase.h"
+#include "GameFramework/QulockReplicationInfo.h"
+#include "Subsystem/EnemySpawnerSubsystem.h"
 #include "Subsystem/PlayerViewDataCachingSubsystem.h"
-
-DECLARE_STATS_GROUP(TEXT("Qulock Movement Logic"), STATGROUP_QulockMovement, STATCAT_Advanced);
+#include "Subsystem/QulockBroadPhaseSubsystem.h"
+#include "Subsystem/QulockEvaluationSubsystem.h"
+#include "Subsystem/QulockOcclusionSubsystem.h"
+#include "Subsystem/QulockReplicationSubsystem.h"
 
 DECLARE_CYCLE_STAT(TEXT("Is Actor Within Player View"), STAT_IsActorWithinPlayerView, STATGROUP_QulockMovement);
 DECLARE_CYCLE_STAT(TEXT("Is Actor Within Player Frustum"), STAT_IsActorWithinPlayerFrustum, STATGROUP_QulockMovement);
+DECLARE_CYCLE_STAT(TEXT("Project Support Vertexes"), STAT_QulockProjectSupportVertexes, STATGROUP_QulockMovement);
+DECLARE_CYCLE_STAT(TEXT("Test Frustum Planes"), STAT_QulockTestFrustumPlanes, STATGROUP_QulockMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Visibility Cache Hits"), STAT_VisibilityCacheHits, STATGROUP_QulockMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Visibility Cache Misses"), STAT_VisibilityCacheMisses, STATGROUP_QulockMovement);
+DECLARE_CYCLE_STAT(TEXT("First Trace"), STAT_QulockFirstTrace, STATGROUP_QulockMovement);
+DECLARE_CYCLE_STAT(TEXT("Reprojection Trace"), STAT_QulockReprojectionTrace, STATGROUP_QulockMovement);
+
+CSV_DEFINE_CATEGORY(Qulock, true);
 
-#define QULOCK_SHOULD_USE_PROJECTED_VERTEX_TRACES 1
 #define QULOCK_SHOULD_SHOW_DEBUG_TRACES 0
 
 // Theory: https://en.wikipedia.org/wiki/Supporting_hyperplane
@@ -26,34 +42,21 @@ DECLARE_CYCLE_STAT(TEXT("Is Actor Within Player Frustum"), STAT_IsActorWithinPla
 
 namespace
 {
-	template <class AllocatorType>
-	FVector ComputeProjectedSupportVertex(TArray<FVector, AllocatorType> const& PolyVertexes,
-										  FMatrix const& ViewProjMat, FIntRect const& ViewRect,
-										  FVector2D const& Direction)
-	{
-		float MaxProjection = -TNumericLimits<float>::Max();
-
-		FVector SupportVertex;
-		for (FVector const& Vertex : PolyVertexes)
-		{
-			FVector2D ScreenVertex;
-			FSceneView::ProjectWorldToScreen(Vertex, ViewRect, ViewProjMat, ScreenVertex);
-
-			float Projection = Direction.Dot(ScreenVertex);
-			if (Projection > MaxProjection)
-			{
-				MaxProjection = Projection;
-				SupportVertex = Vertex;
-			}
-		}
-
-		return SupportVertex;
-	}
+	// Extend trace a bit to ensure it hits the geometry;
+	// We could make this into a UPROPERTY if necessary, but this is good enough for now.
+	constexpr float TraceTolerance = 10.f;
 
 	FVector ProjectPointOntoPlane(FVector const& Point, FVector const& PlaneOrigin, FVector const& PlaneNormal)
 	{
 		return PlaneNormal * FVector::DotProduct(PlaneOrigin - Point, PlaneNormal) + Point;
 	}
+
+	QulockInstrumentation::ETraceResult GetInstrumentedTraceResult(bool bHit, FHitResult const& HitResult, AActor const* Actor)
+	{
+		return !bHit ? QulockInstrumentation::ETraceResult::Missed
+			 : HitResult.GetActor() == Actor ? QulockInstrumentation::ETraceResult::HitTarget
+			 : QulockInstrumentation::ETraceResult::HitOther;
+	}
 }
 
 UQulockComponent::UQulockComponent(FObjectInitializer const& ObjectInitializer)
@@ -61,6 +64,8 @@ UQulockComponent::UQulockComponent(FObjectInitializer const& ObjectInitializer)
 {
 	PrimaryComponentTick.bCanEverTick = false;
 	PrimaryComponentTick.bStartWithTickEnabled = false;
+
+	bAutoActivate = true;
 }
 
 void UQulockComponent::BeginPlay()
@@ -68,16 +73,32 @@ void UQulockComponent::BeginPlay()
 	Super::BeginPlay();
 
 	UWorld* World = GetWorld();
-	
-	for (EAutoReceiveInput::Type PlayerIndex : PlayersToCheck)
+
+	if (bCheckAllConnectedPlayers && World->GetNetMode() != NM_Standalone)
 	{
-		int32 PlayerControllerIndex = PlayerIndex - EAutoReceiveInput::Player0;
-		if (ensureMsgf(PlayerControllerIndex != INDEX_NONE, TEXT("PlayersToCheck was improperly configured")))
+		for (auto PlayerControllerIter = World->GetPlayerControllerIterator(); PlayerControllerIter; ++PlayerControllerIter)
 		{
-			auto PlayerControllerIter = World->GetPlayerControllerIterator();
-			PlayerControllerIter += PlayerControllerIndex;
+			if (APlayerController* PlayerController = PlayerControllerIter->Get())
+			{
+				SetupPlayerToCheck(PlayerController);
+			}
+		}
+
+		PostLoginHandle = FGameModeEvents::GameModePostLoginEvent.AddUObject(this, &UQulockComponent::HandlePostLogin);
+		LogoutHandle = FGameModeEvents::GameModeLogoutEvent.AddUObject(this, &UQulockComponent::HandleLogout);
+	}
+	else
+	{
+		for (EAutoReceiveInput::Type PlayerIndex : PlayersToCheck)
+		{
+			int32 PlayerControllerIndex = PlayerIndex - EAutoReceiveInput::Player0;
+			if (ensureMsgf(PlayerControllerIndex != INDEX_NONE, TEXT("PlayersToCheck was improperly configured")))
+			{
+				auto PlayerControllerIter = World->GetPlayerControllerIterator();
+				PlayerControllerIter += PlayerControllerIndex;
 
-			SetupPlayerToCheck(PlayerControllerIter->Get());
+				SetupPlayerToCheck(PlayerControllerIter->Get());
+			}
 		}
 	}
 	
@@ -95,6 +116,98 @@ void UQulockComponent::BeginPlay()
 	{
 		UpdateTraceParams(Target);
 	}
+
+	if (bUseIgnoredActorsTraceChannel)
+	{
+		GetEvaluationSubsystem()->RegisterIgnoredClasses(ActorsToIgnore);
+	}
+	else if (UEnemySpawnerSubsystem* EnemySpawner = World->GetSubsystem<UEnemySpawnerSubsystem>())
+	{
+		EnemyActivatedHandle = EnemySpawner->OnEnemyActivated.AddUObject(this, &UQulockComponent::HandleEnemyActivated);
+	}
+
+	// Even targets that aren't batched are registered, so that their changes get published
+	if (IsActive())
+	{
+		GetEvaluationSubsystem()->RegisterQulockTarget(this);
+	}
+}
+
+void UQulockComponent::EndPlay(EEndPlayReason::Type const EndPlayReason)
+{
+	GetEvaluationSubsystem()->UnregisterQulockTarget(this);
+	GetEvaluationSubsystem()->RemoveTargetTickPrerequisite(TraceTarget.Get());
+
+	if (bUseIgnoredActorsTraceChannel)
+	{
+		GetEvaluationSubsystem()->UnregisterIgnoredClasses(ActorsToIgnore);
+	}
+
+	FGameModeEvents::GameModePostLoginEvent.Remove(PostLoginHandle);
+	FGameModeEvents::GameModeLogoutEvent.Remove(LogoutHandle);
+	PostLoginHandle.Reset();
+	LogoutHandle.Reset();
+
+	if (UEnemySpawnerSubsystem* EnemySpawner = GetWorld()->GetSubsystem<UEnemySpawnerSubsystem>())
+	{
+		EnemySpawner->OnEnemyActivated.Remove(EnemyActivatedHandle);
+	}
+	EnemyActivatedHandle.Reset();
+
+	if (AQulockReplicationInfo* ReplicationInfo = GetReplicationSubsystem()->GetReplicationInfo())
+	{
+		ReplicationInfo->RemoveTarget(Cast<APawn>(TraceTarget.Get()));
+	}
+
+	CacheTargetBounds(nullptr);
+	VisibilityCacheMap.Reset();
+	
+	Super::EndPlay(EndPlayReason);
+}
+
+void UQulockComponent::Activate(bool const bReset)
+{
+	bool const bWasActive = IsActive();
+
+	Super::Activate(bReset);
+
+	// BeginPlay registers whatever is active by then
+	if (bWasActive || !IsActive() || !HasBegunPlay())
+	{
+		return;
+	}
+
+	if (AActor* Target = TraceTarget.Get())
+	{
+		CacheTargetBounds(Target);
+		GetEvaluationSubsystem()->AddTargetTickPrerequisite(Target);
+	}
+
+	GetEvaluationSubsystem()->RegisterQulockTarget(this);
+}
+
+void UQulockComponent::Deactivate()
+{
+	bool const bWasActive = IsActive();
+
+	Super::Deactivate();
+
+	if (!bWasActive || IsActive() || !HasBegunPlay())
+	{
+		return;
+	}
+
+	GetEvaluationSubsystem()->UnregisterQulockTarget(this);
+	GetEvaluationSubsystem()->RemoveTargetTickPrerequisite(TraceTarget.Get());
+
+	if (AQulockReplicationInfo* ReplicationInfo = GetReplicationSubsystem()->GetReplicationInfo())
+	{
+		ReplicationInfo->RemoveTarget(Cast<APawn>(TraceTarget.Get()));
+	}
+
+	// The trace target is kept, but nothing about it is tracked until we're active again
+	CacheTargetBounds(nullptr);
+	VisibilityCacheMap.Reset();
 }
 
 void UQulockComponent::SetupPlayerToCheck(APlayerController* PlayerController)
@@ -120,11 +233,46 @@ bool UQulockComponent::CanMoveThisFrame() const
 		return bCachedCanMoveThisFrame.GetValue();
 	}
 
+	if (ShouldUseBatchedEvaluation())
+	{
+		bCachedCanMoveThisFrame = !GetEvaluationSubsystem()->IsTargetObserved(this);
+		return bCachedCanMoveThisFrame.GetValue();
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_IsActorWithinPlayerView);
+	CSV_SCOPED_TIMING_STAT(Qulock, IsActorWithinPlayerView);
+
+	AActor* Target = TraceTarget.Get();
+
+	// Any player seeing the target is enough, so the cached results of every player go first,
+	// and only then are the rest evaluated, one after another, up to the first one that sees it.
+	TArray<APlayerController*, TInlineAllocator<4>> PlayerArray;
+	GetPlayersWithinBroadPhase(PlayerArray);
+
+	TArray<APlayerController*, TInlineAllocator<4>> UncachedPlayerArray;
+	for (APlayerController* Player : PlayerArray)
+	{
+		if (IsCachedInView(Player, Target))
+		{
+			bCachedCanMoveThisFrame = false;
+			return false;
+		}
+
+		UncachedPlayerArray.Add(Player);
+	}
+
 	bCachedCanMoveThisFrame = true;
-	for (APlayerController* Player : PlayerControllerSet)
+
+	if (int32 const LastObservingIndex = UncachedPlayerArray.Find(LastObservingPlayer.Get()); LastObservingIndex > 0)
+	{
+		UncachedPlayerArray.Swap(0, LastObservingIndex);
+	}
+
+	for (APlayerController* Player : UncachedPlayerArray)
 	{
-		if (IsActorWithinPlayerView(Player, TraceTarget.Get()))
+		if (EvaluateActorWithinPlayerView(Player, Target))
 		{
+			LastObservingPlayer = Player;
 			bCachedCanMoveThisFrame = false;
 			break;
 		}
@@ -133,6 +281,28 @@ bool UQulockComponent::CanMoveThisFrame() const
 	return bCachedCanMoveThisFrame.GetValue();
 }
 
+bool UQulockComponent::CanMove() const
+{
+	return bPublishedCanMove;
+}
+
+void UQulockComponent::PublishCanMove()
+{
+	bool const bCanMove = CanMoveThisFrame();
+
+	// Every frame, not only when it changes, so targets are known to the clients from the start, frozen or not
+	if (AQulockReplicationInfo* ReplicationInfo = GetReplicationSubsystem()->GetReplicationInfo())
+	{
+		ReplicationInfo->SetTargetFrozen(Cast<APawn>(TraceTarget.Get()), !bCanMove);
+	}
+
+	if (bCanMove != bPublishedCanMove)
+	{
+		bPublishedCanMove = bCanMove;
+		OnCanMoveChanged.Broadcast(bCanMove);
+	}
+}
+
 // Having code in macros is not great for the maintainability of the code in the macros,
 // but it's great for the method that uses the macros, which has far more important logic.
 #if QULOCK_SHOULD_SHOW_DEBUG_TRACES
@@ -153,53 +323,130 @@ bool UQulockComponent::CanMoveThisFrame() const
 bool UQulockComponent::IsActorWithinPlayerView(APlayerController* Player, AActor* Actor) const
 {
 	SCOPE_CYCLE_COUNTER(STAT_IsActorWithinPlayerView);
+	CSV_SCOPED_TIMING_STAT(Qulock, IsActorWithinPlayerView);
+
+	if (IsCachedInView(Player, Actor))
+	{
+		return true;
+	}
+
+	return EvaluateActorWithinPlayerView(Player, Actor);
+}
+
+bool UQulockComponent::IsCachedInView(APlayerController* Player, AActor* Actor) const
+{
+	if (!bUseVisibilityCache)
+	{
+		return false;
+	}
+
+	FPlayerViewData const& PlayerViewData = GetCachingSubsystem()->GetPlayerViewData(Player);
+	UQulockOcclusionSubsystem* Occlusion = GetOcclusionSubsystem();
+	uint32 const OccluderEpoch = Occlusion ? Occlusion->GetOccluderEpoch() : 0;
+	double const Time = GetWorld()->GetTimeSeconds();
+
+	FQulockVisibilityCacheEntry const* CacheEntryPtr = VisibilityCacheMap.Find(Player);
+	if (CacheEntryPtr && PlayerViewData.bIsValid && CanReuseVisibilityResult(*CacheEntryPtr, PlayerViewData, Actor, OccluderEpoch, Time))
+	{
+		INC_DWORD_STAT(STAT_VisibilityCacheHits);
+		return true;
+	}
+
+	INC_DWORD_STAT(STAT_VisibilityCacheMisses);
+	return false;
+}
+
+void UQulockComponent::CacheVisibilityResult(APlayerController* Player, AActor* Actor, bool const bIsInView) const
+{
+	if (!bUseVisibilityCache)
+	{
+		return;
+	}
+
+	// Not being in view is never reused: the view or the target might have moved too little to tell, but enough to see it
+	if (!bIsInView)
+	{
+		VisibilityCacheMap.Remove(Player);
+		return;
+	}
+
+	FPlayerViewData const& PlayerViewData = GetCachingSubsystem()->GetPlayerViewData(Player);
+	UQulockOcclusionSubsystem* Occlusion = GetOcclusionSubsystem();
+
+	FQulockVisibilityCacheEntry& CacheEntry = VisibilityCacheMap.FindOrAdd(Player);
+	CacheEntry.Actor = Actor;
+	CacheEntry.ViewOrigin = PlayerViewData.ViewOrigin;
+	CacheEntry.ViewForwardDir = PlayerViewData.InvViewRotMatrix.GetScaledAxis(EAxis::Z);
+	CacheEntry.ViewUpDir = PlayerViewData.WorldUpDir;
+	CacheEntry.ActorLocation = Actor->GetActorLocation();
+	CacheEntry.ActorRotation = Actor->GetActorQuat();
+	CacheEntry.OccluderEpoch = Occlusion ? Occlusion->GetOccluderEpoch() : 0;
+	CacheEntry.EvaluatedTime = GetWorld()->GetTimeSeconds();
+}
+
+bool UQulockComponent::EvaluateActorWithinPlayerView(APlayerController* Player, AActor* Actor) const
+{
+	if (bUseOcclusionBuffer)
+	{
+		TArray<FVector> SupportVertexArray;
+		bool const bIsInView = IsActorWithinPlayerFrustum(Player, Actor, SupportVertexArray)
+							&& !GetOcclusionSubsystem()->IsBoundsOccluded(Player, GetActorBoundsVertexes(Actor));
+		CacheVisibilityResult(Player, Actor, bIsInView);
+		return bIsInView;
+	}
 	
 	UWorld* World = GetWorld();
-	FPlayerViewData PlayerViewData = GetCachingSubsystem()->GetPlayerViewData(Player);
+	FPlayerViewData const& PlayerViewData = GetCachingSubsystem()->GetPlayerViewData(Player);
 
 	FVector const& ViewOrigin = PlayerViewData.ViewOrigin;
-#if QULOCK_SHOULD_USE_PROJECTED_VERTEX_TRACES
-	FMatrix const& ViewProjMatrix = PlayerViewData.ViewProjMatrix;
+	FPlane const (&FrustumPlaneArray)[4] = PlayerViewData.FrustumPlanes;
+	bool const bUseProjectedVertexTraces = QulockInstrumentation::ShouldUseProjectedVertexTraces();
 
-	TArray<FPlane, TFixedAllocator<4>> FrustumPlaneArray;
-	FrustumPlaneArray.SetNum(4);
+	ECollisionChannel const TraceChannel = GetTraceChannel();
+	bool const bDoesMissSeeTarget = DoesTraceMissSeeTarget();
+	bool bIsInView = false;
+	int32 NumTraces = 0;
+	int32 NumReprojectionTraces = 0;
 
-	ViewProjMatrix.GetFrustumLeftPlane(FrustumPlaneArray[0]);
-	ViewProjMatrix.GetFrustumRightPlane(FrustumPlaneArray[1]);
-	ViewProjMatrix.GetFrustumTopPlane(FrustumPlaneArray[2]);
-	ViewProjMatrix.GetFrustumBottomPlane(FrustumPlaneArray[3]);
-#endif
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(QulockEvaluateTarget, QulockChannel);
 
-	bool bIsInView = false;
+	QULOCK_CAPTURE_DECLARE(Player, PlayerViewData, GetActorBoundsVertexes(Actor));
 
 	TArray<FVector> SupportVertexArray;
-	if (IsActorWithinPlayerFrustum(Player, Actor, SupportVertexArray))
+	bool bIsWithinFrustum = IsActorWithinPlayerFrustum(Player, Actor, SupportVertexArray);
+	QULOCK_CAPTURE_FRUSTUM(bIsWithinFrustum, SupportVertexArray);
+	
+	if (bIsWithinFrustum)
 	{
 		bool bNewIsInView = true;
 		for (FVector Vertex : SupportVertexArray)
 		{
-			// Extend trace a bit to ensure it hits the geometry;
-			// We could make this into a UPROPERTY if necessary, but this is good enough for now.
-			constexpr float TraceTolerance = 10.f;
-
 			FVector TraceDirection = (Vertex - ViewOrigin).GetUnsafeNormal();
 			Vertex += TraceDirection * TraceTolerance;
 
 			QULOCK_DRAW_DEBUG_TRACE();
 			
 			FHitResult HitResult;
-			if (World->LineTraceSingleByChannel(HitResult, ViewOrigin, Vertex, ECC_Visibility, TraceParams))
+			bool bHit;
+			{
+				SCOPE_CYCLE_COUNTER(STAT_QulockFirstTrace);
+				bHit = World->LineTraceSingleByChannel(HitResult, ViewOrigin, Vertex, TraceChannel, TraceParams);
+			}
+			++NumTraces;
+			QULOCK_CAPTURE_TRACE(bHit, HitResult, Vertex, Actor);
+			QulockInstrumentation::TraceLineTrace(this, Player, GetInstrumentedTraceResult(bHit, HitResult, Actor), false);
+			
+			if (bHit || bDoesMissSeeTarget)
 			{
 				QULOCK_DRAW_DEBUG_TRACE_RESULT();
 
 				// NOTE: this currently has a limitation: if the point is actually outside the view frustum,
 				// it will still report as a hit, but the actor might not be visible anymore due to occluding actors.
-				// QULOCK_SHOULD_USE_PROJECTED_VERTEX_TRACES tries to mitigate this,
+				// Qulock.ProjectedVertexTraces tries to mitigate this,
 				// and does it pretty decently, although not perfectly.
 				
-				bNewIsInView = HitResult.GetActor() == Actor;
-#			if QULOCK_SHOULD_USE_PROJECTED_VERTEX_TRACES
-				if (bNewIsInView)
+				bNewIsInView = !bHit || HitResult.GetActor() == Actor;
+				if (bNewIsInView && bUseProjectedVertexTraces)
 				{
 					bool bShouldProject = false;
 				
@@ -218,31 +465,40 @@ bool UQulockComponent::IsActorWithinPlayerView(APlayerController* Player, AActor
 						QULOCK_DRAW_DEBUG_TRACE();
 						
 						HitResult.Reset();
-						if (World->LineTraceSingleByChannel(HitResult, ViewOrigin, Vertex, ECC_Visibility, TraceParams))
+						{
+							SCOPE_CYCLE_COUNTER(STAT_QulockReprojectionTrace);
+							bHit = World->LineTraceSingleByChannel(HitResult, ViewOrigin, Vertex, TraceChannel, TraceParams);
+						}
+						++NumTraces;
+						++NumReprojectionTraces;
+						QULOCK_CAPTURE_TRACE(bHit, HitResult, Vertex, Actor);
+						QulockInstrumentation::TraceLineTrace(this, Player, GetInstrumentedTraceResult(bHit, HitResult, Actor), true);
+						
+						if (bHit)
 						{
 							QULOCK_DRAW_DEBUG_TRACE_RESULT();
 
 							bNewIsInView = HitResult.GetActor() == Actor;
 						}
 					}
-				
-					if (bNewIsInView)
-					{
-						bIsInView = true;
-						QULOCK_BREAK_TRACE();
-					}
 				}
-#			else
+
 				if (bNewIsInView)
 				{
 					bIsInView = true;
 					QULOCK_BREAK_TRACE();
 				}
-#			endif
 			}
 		}
 	}
 
+	QULOCK_CAPTURE_RESULT(bIsInView);
+
+	QulockInstrumentation::CountTraces(NumTraces, NumReprojectionTraces);
+	QulockInstrumentation::TraceEvaluation(this, bIsInView, false);
+
+	CacheVisibilityResult(Player, Actor, bIsInView);
+
 	return bIsInView;
 }
 
@@ -250,111 +506,181 @@ bool UQulockComponent::IsActorWithinPlayerFrustum(APlayerController* Player, AAc
 												  TArray<FVector>& OutSupportVertexes) const
 {
 	SCOPE_CYCLE_COUNTER(STAT_IsActorWithinPlayerFrustum);
+	CSV_SCOPED_TIMING_STAT(Qulock, IsActorWithinPlayerFrustum);
 	
-	FPlayerViewData PlayerViewData = GetCachingSubsystem()->GetPlayerViewData(Player);
+	FPlayerViewData const& PlayerViewData = GetCachingSubsystem()->GetPlayerViewData(Player);
 	
 	FMatrix const& ViewProjMat = PlayerViewData.ViewProjMatrix;
-	FMatrix const& InvViewRotMat = PlayerViewData.InvViewRotMatrix;
-	FIntRect const& ViewRect = PlayerViewData.ViewRectangle;
 
-	// TODO this is quite inaccurate... but it will work for now
-	FBox ActorBounds = Actor->GetComponentsBoundingBox();
+	TStaticArray<FVector, 8> ActorBoundsVertexes = GetActorBoundsVertexes(Actor);
 
-	FVector ActorBoundsPos = ActorBounds.GetCenter();
-	FVector ActorBoundsSizeAbs = ActorBounds.GetExtent();
-		
-	TArray<FVector, TFixedAllocator<8>> ActorBoundsVertexes;
-	ActorBoundsVertexes.Add(ActorBoundsPos + FVector(+ActorBoundsSizeAbs.X, +ActorBoundsSizeAbs.Y, +ActorBoundsSizeAbs.Z));
-	ActorBoundsVertexes.Add(ActorBoundsPos + FVector(+ActorBoundsSizeAbs.X, +ActorBoundsSizeAbs.Y, -ActorBoundsSizeAbs.Z));
-	ActorBoundsVertexes.Add(ActorBoundsPos + FVector(+ActorBoundsSizeAbs.X, -ActorBoundsSizeAbs.Y, +ActorBoundsSizeAbs.Z));
-	ActorBoundsVertexes.Add(ActorBoundsPos + FVector(+ActorBoundsSizeAbs.X, -ActorBoundsSizeAbs.Y, -ActorBoundsSizeAbs.Z));
-	ActorBoundsVertexes.Add(ActorBoundsPos + FVector(-ActorBoundsSizeAbs.X, +ActorBoundsSizeAbs.Y, +ActorBoundsSizeAbs.Z));
-	ActorBoundsVertexes.Add(ActorBoundsPos + FVector(-ActorBoundsSizeAbs.X, +ActorBoundsSizeAbs.Y, -ActorBoundsSizeAbs.Z));
-	ActorBoundsVertexes.Add(ActorBoundsPos + FVector(-ActorBoundsSizeAbs.X, -ActorBoundsSizeAbs.Y, +ActorBoundsSizeAbs.Z));
-	ActorBoundsVertexes.Add(ActorBoundsPos + FVector(-ActorBoundsSizeAbs.X, -ActorBoundsSizeAbs.Y, -ActorBoundsSizeAbs.Z));
-
-	static FVector2D ScreenLeftDir(-1.f, 0.f);
-	static FVector2D ScreenRightDir(+1.f, 0.f);
-	static FVector2D ScreenUpDir(0.f, -1.f);
-	static FVector2D ScreenDownDir(0.f, +1.f);
-	
-	FPlane RightPlane;
-	ViewProjMat.GetFrustumRightPlane(RightPlane);
-	
-	FVector LeftSupportVertex = ComputeProjectedSupportVertex(ActorBoundsVertexes, ViewProjMat,
-															  ViewRect, ScreenLeftDir);
-
-	float LeftSignedDistance = RightPlane.PlaneDot(LeftSupportVertex);
-	if (LeftSignedDistance > 0)
+	FVector SupportVertexes[4];
+	int32 RejectingPlane = INDEX_NONE;
+	bool bIsWithinFrustum;
+	if (QulockInstrumentation::ShouldUseVectorizedSupportVertexes())
 	{
-		return false;
-	}
-
-	FPlane LeftPlane;
-	ViewProjMat.GetFrustumLeftPlane(LeftPlane);
-
-	FVector RightSupportVertex = ComputeProjectedSupportVertex(ActorBoundsVertexes, ViewProjMat,
-															   ViewRect, ScreenRightDir);
+		// Both stages are timed here rather than in the kernel, so it stays as lean as the microbenchmark measures it
+		{
+			SCOPE_CYCLE_COUNTER(STAT_QulockProjectSupportVertexes);
+			bIsWithinFrustum = QulockSupportVertexKernel::ProjectSupportVertexesVectorized(ActorBoundsVertexes, ViewProjMat, SupportVertexes);
+		}
 
-	float RightSignedDistance = LeftPlane.PlaneDot(RightSupportVertex);
-	if (RightSignedDistance > 0)
-	{
-		return false;
+		if (bIsWithinFrustum)
+		{
+			SCOPE_CYCLE_COUNTER(STAT_QulockTestFrustumPlanes);
+			bIsWithinFrustum = QulockSupportVertexKernel::TestFrustumPlanesVectorized(SupportVertexes, PlayerViewData.FrustumPlanes, &RejectingPlane);
+		}
 	}
-	
-	FPlane BottomPlane;
-	ViewProjMat.GetFrustumBottomPlane(BottomPlane);
-	
-	FVector TopSupportVertex = ComputeProjectedSupportVertex(ActorBoundsVertexes, ViewProjMat,
-															 ViewRect, ScreenUpDir);
-
-	float TopSignedDistance = BottomPlane.PlaneDot(TopSupportVertex);
-	if (TopSignedDistance > 0)
+	else
 	{
-		return false;
+		bIsWithinFrustum = QulockSupportVertexKernel::ComputeScalar(ActorBoundsVertexes, ViewProjMat, PlayerViewData.ViewRectangle,
+																	 SupportVertexes, &RejectingPlane);
 	}
-	
-	FPlane TopPlane;
-	ViewProjMat.GetFrustumTopPlane(TopPlane);
-	
-	FVector BottomSupportVertex = ComputeProjectedSupportVertex(ActorBoundsVertexes, ViewProjMat,
-																ViewRect, ScreenDownDir);
 
-	float BottomSignedDistance = TopPlane.PlaneDot(BottomSupportVertex);
-	if (BottomSignedDistance > 0)
+	if (!bIsWithinFrustum)
 	{
+		QulockInstrumentation::TraceFrustumRejection(this, Player, RejectingPlane);
 		return false;
 	}
 	
 	// These are the axes of the player view's frame of reference
-	FVector WorldRightDir = InvViewRotMat.GetScaledAxis(EAxis::X);
+	FVector const& WorldRightDir = PlayerViewData.WorldRightDir;
 	FVector WorldLeftDir = -WorldRightDir;
-	FVector WorldUpDir = InvViewRotMat.GetScaledAxis(EAxis::Y);
+	FVector const& WorldUpDir = PlayerViewData.WorldUpDir;
 	FVector WorldDownDir = -WorldUpDir;
 
 	OutSupportVertexes.Reserve(4);
 	
 	// We'll push the vertexes into the mesh a bit to ensure the raycast always hits when it should
-	OutSupportVertexes.Add(LeftSupportVertex + WorldRightDir);
-	OutSupportVertexes.Add(RightSupportVertex + WorldLeftDir);
-	OutSupportVertexes.Add(TopSupportVertex + WorldDownDir);
-	OutSupportVertexes.Add(BottomSupportVertex + WorldUpDir);
+	OutSupportVertexes.Add(SupportVertexes[0] + WorldRightDir);
+	OutSupportVertexes.Add(SupportVertexes[1] + WorldLeftDir);
+	OutSupportVertexes.Add(SupportVertexes[2] + WorldDownDir);
+	OutSupportVertexes.Add(SupportVertexes[3] + WorldUpDir);
+
+	return true;
+}
+
+void UQulockComponent::GetPlayersWithinBroadPhase(TArray<APlayerController*, TInlineAllocator<4>>& OutPlayerArray) const
+{
+	GetBroadPhaseSubsystem()->GetPlayersWithTargetInFrustum(this, PlayerControllerSet, OutPlayerArray);
+}
+
+bool UQulockComponent::ComputePlayerViewTraces(APlayerController* Player, AActor* Actor, TArray<FQulockViewTrace>& OutViewTraces,
+											   QulockFrameCapture::FCapturedEvaluation* OutCapturedEvaluation) const
+{
+	FPlayerViewData const& PlayerViewData = GetCachingSubsystem()->GetPlayerViewData(Player);
+
+	FVector const& ViewOrigin = PlayerViewData.ViewOrigin;
+	FPlane const (&FrustumPlaneArray)[4] = PlayerViewData.FrustumPlanes;
+	bool const bUseProjectedVertexTraces = QulockInstrumentation::ShouldUseProjectedVertexTraces();
+
+	TArray<FVector> SupportVertexArray;
+	bool const bIsWithinFrustum = IsActorWithinPlayerFrustum(Player, Actor, SupportVertexArray);
+
+	if (OutCapturedEvaluation)
+	{
+		OutCapturedEvaluation->BoundsVertexes = GetActorBoundsVertexes(Actor);
+		OutCapturedEvaluation->SupportVertexes = SupportVertexArray;
+		OutCapturedEvaluation->bIsWithinFrustum = bIsWithinFrustum;
+	}
+
+	if (!bIsWithinFrustum)
+	{
+		return false;
+	}
+
+	OutViewTraces.Reserve(OutViewTraces.Num() + SupportVertexArray.Num());
+	for (FVector Vertex : SupportVertexArray)
+	{
+		FVector TraceDirection = (Vertex - ViewOrigin).GetUnsafeNormal();
+		Vertex += TraceDirection * TraceTolerance;
+
+		FQulockViewTrace& ViewTrace = OutViewTraces.AddDefaulted_GetRef();
+		ViewTrace.Start = ViewOrigin;
+		ViewTrace.End = Vertex;
+		
+		// Unlike IsActorWithinPlayerView, we can't wait for the first trace to know if we need the second one,
+		// so we compute the projected vertex upfront and let the caller trace both at once.
+		if (bUseProjectedVertexTraces)
+		{
+			for (FPlane const& Plane : FrustumPlaneArray)
+			{
+				if (Plane.PlaneDot(Vertex) > 0)
+				{
+					FVector PlaneNormal = Plane.GetNormal();
+					Vertex = ProjectPointOntoPlane(Vertex, ViewOrigin, PlaneNormal);
+					ViewTrace.bShouldProject = true;
+				}
+			}
+		}
+
+		ViewTrace.ProjectedEnd = Vertex;
+	}
 
 	return true;
 }
 
 FMatrix UQulockComponent::GetPlayerViewProjMatrix(APlayerController* Player) const
 {
-	FPlayerViewData PlayerViewData = GetCachingSubsystem()->GetPlayerViewData(Player);
+	FPlayerViewData const& PlayerViewData = GetCachingSubsystem()->GetPlayerViewData(Player);
 	return PlayerViewData.ViewProjMatrix;
 }
 
 FVector UQulockComponent::GetPlayerViewOrigin(APlayerController* Player) const
 {
-	FPlayerViewData PlayerViewData = GetCachingSubsystem()->GetPlayerViewData(Player);
+	FPlayerViewData const& PlayerViewData = GetCachingSubsystem()->GetPlayerViewData(Player);
 	return PlayerViewData.ViewOrigin;
 }
 
+bool UQulockComponent::CanReuseVisibilityResult(FQulockVisibilityCacheEntry const& CacheEntry, FPlayerViewData const& PlayerViewData,
+												 AActor* Actor, uint32 OccluderEpoch, double Time) const
+{
+	if (CacheEntry.Actor.Get() != Actor
+		|| CacheEntry.OccluderEpoch != OccluderEpoch
+		|| Time - CacheEntry.EvaluatedTime > MaxCachedResultAge)
+	{
+		return false;
+	}
+
+	// Both rotations are compared through the angle between their axes, so that the thresholds are in degrees
+	float const ViewRotationCos = FMath::Cos(FMath::DegreesToRadians(ViewRotationThreshold));
+	FVector const ViewForwardDir = PlayerViewData.InvViewRotMatrix.GetScaledAxis(EAxis::Z);
+	if (FVector::DistSquared(CacheEntry.ViewOrigin, PlayerViewData.ViewOrigin) > FMath::Square(ViewOriginThreshold)
+		|| FVector::DotProduct(CacheEntry.ViewForwardDir, ViewForwardDir) < ViewRotationCos
+		|| FVector::DotProduct(CacheEntry.ViewUpDir, PlayerViewData.WorldUpDir) < ViewRotationCos)
+	{
+		return false;
+	}
+
+	return FVector::DistSquared(CacheEntry.ActorLocation, Actor->GetActorLocation()) <= FMath::Square(TargetLocationThreshold)
+		&& CacheEntry.ActorRotation.AngularDistance(Actor->GetActorQuat()) <= FMath::DegreesToRadians(TargetRotationThreshold);
+}
+
+AActor* UQulockComponent::GetTraceTarget() const
+{
+	return TraceTarget.Get();
+}
+
+FCollisionQueryParams const& UQulockComponent::GetTraceParams() const
+{
+	return TraceParams;
+}
+
+ECollisionChannel UQulockComponent::GetTraceChannel() const
+{
+	return bUseIgnoredActorsTraceChannel ? ECC_QulockVisibility : ECC_Visibility;
+}
+
+bool UQulockComponent::DoesTraceMissSeeTarget() const
+{
+	return bUseIgnoredActorsTraceChannel;
+}
+
+TSet<APlayerController*> const& UQulockComponent::GetPlayerControllerSet() const
+{
+	return PlayerControllerSet;
+}
+
 void UQulockComponent::UpdateTraceParams(AActor* TargetActor)
 {
 	UWorld* World = GetWorld();
@@ -370,8 +696,11 @@ void UQulockComponent::UpdateTraceParams(AActor* TargetActor)
 		TimerManager.ClearTimer(Handle);
 	}
 	
+	GetEvaluationSubsystem()->RemoveTargetTickPrerequisite(TraceTarget.Get());
 	TraceTarget.Reset();
 	TraceParams.ClearIgnoredActors();
+	CacheTargetBounds(nullptr);
+	VisibilityCacheMap.Reset();
 	
 	TraceParamsUpdateHandle = TimerManager.SetTimerForNextTick(
 		[this, TargetActor, TargetWorld = TWeakObjectPtr<UWorld>{World}]
@@ -379,8 +708,38 @@ void UQulockComponent::UpdateTraceParams(AActor* TargetActor)
 			if (UWorld* World = TargetWorld.Get())
 			{
 				TraceTarget = TargetActor;
+
+				// Otherwise, these wait until we're activated
+				if (IsActive())
+				{
+					CacheTargetBounds(TargetActor);
+
+					// Our changes are published before the target moves, so it never moves on a frame it's already observed on
+					GetEvaluationSubsystem()->AddTargetTickPrerequisite(TargetActor);
+				}
+				
+				// Nothing to add, they ignore the trace channel
+				if (bUseIgnoredActorsTraceChannel)
+				{
+					return;
+				}
+
+				// Pawns are already tracked by the game mode, only other classes need to go through the world
+				AMXFPSGameModeBase const* GameMode = World->GetAuthGameMode<AMXFPSGameModeBase>();
 				for (auto ActorClass : ActorsToIgnore)
 				{
+					if (GameMode && ActorClass && ActorClass->IsChildOf<APawn>())
+					{
+						for (FMXFPSRegisteredPawn const& RegisteredPawn : GameMode->GetRegisteredPawns())
+						{
+							if (RegisteredPawn.Pawn != TargetActor && RegisteredPawn.Pawn->IsA(ActorClass))
+							{
+								TraceParams.AddIgnoredActor(RegisteredPawn.Pawn);
+							}
+						}
+						continue;
+					}
+
 					for (TActorIterator ActorIter{World, ActorClass}; ActorIter; ++ActorIter)
 					{
 						AActor* Actor = *ActorIter;
@@ -395,6 +754,46 @@ void UQulockComponent::UpdateTraceParams(AActor* TargetActor)
 	);
 }
 
+void UQulockComponent::CacheTargetBounds(AActor* TargetActor)
+{
+	if (USceneComponent* RootComponent = TargetRootComponent.Get())
+	{
+		RootComponent->TransformUpdated.Remove(TargetTransformUpdatedHandle);
+	}
+
+	TargetRootComponent.Reset();
+	TargetTransformUpdatedHandle.Reset();
+
+	if (UQulockBroadPhaseSubsystem* BroadPhase = GetBroadPhaseSubsystem())
+	{
+		BroadPhase->RemoveTarget(this);
+	}
+
+	USceneComponent* RootComponent = TargetActor ? TargetActor->GetRootComponent() : nullptr;
+	if (!RootComponent)
+	{
+		return;
+	}
+
+	// Unlike GetComponentsBoundingBox, these bounds follow the rotation of the target,
+	// so they don't grow (and make the target visible when it isn't) when it turns.
+	TargetLocalBounds = TargetActor->CalculateComponentsBoundingBoxInLocalSpace();
+	TargetRootComponent = RootComponent;
+	TargetTransformUpdatedHandle = RootComponent->TransformUpdated.AddUObject(this, &UQulockComponent::HandleTargetTransformUpdated);
+
+	HandleTargetTransformUpdated(RootComponent, EUpdateTransformFlags::None, ETeleportType::None);
+}
+
+TStaticArray<FVector, 8> UQulockComponent::GetActorBoundsVertexes(AActor* Actor) const
+{
+	if (Actor == TraceTarget.Get() && TargetRootComponent.IsValid())
+	{
+		return TargetBoundsVertexes;
+	}
+
+	return QulockSupportVertexKernel::MakeBoundsVertexes(Actor->GetComponentsBoundingBox());
+}
+
 UPlayerViewDataCachingSubsystem* UQulockComponent::GetCachingSubsystem() const
 {
 	return CachingSubsystem
@@ -402,7 +801,99 @@ UPlayerViewDataCachingSubsystem* UQulockComponent::GetCachingSubsystem() const
 		 : CachingSubsystem = GetWorld()->GetSubsystem<UPlayerViewDataCachingSubsystem>();
 }
 
-void UQulockComponent::HandleTraceTargetChanged(APawn*, APawn* NewPawn)
+UQulockEvaluationSubsystem* UQulockComponent::GetEvaluationSubsystem() const
+{
+	return EvaluationSubsystem
+		 ? EvaluationSubsystem
+		 : EvaluationSubsystem = GetWorld()->GetSubsystem<UQulockEvaluationSubsystem>();
+}
+
+UQulockOcclusionSubsystem* UQulockComponent::GetOcclusionSubsystem() const
+{
+	return OcclusionSubsystem
+		 ? OcclusionSubsystem
+		 : OcclusionSubsystem = GetWorld()->GetSubsystem<UQulockOcclusionSubsystem>();
+}
+
+UQulockBroadPhaseSubsystem* UQulockComponent::GetBroadPhaseSubsystem() const
+{
+	return BroadPhaseSubsystem
+		 ? BroadPhaseSubsystem
+		 : BroadPhaseSubsystem = GetWorld()->GetSubsystem<UQulockBroadPhaseSubsystem>();
+}
+
+UQulockReplicationSubsystem* UQulockComponent::GetReplicationSubsystem() const
 {
+	return ReplicationSubsystem
+		 ? ReplicationSubsystem
+		 : ReplicationSubsystem = GetWorld()->GetSubsystem<UQulockReplicationSubsystem>();
+}
+
+bool UQulockComponent::ShouldUseBatchedEvaluation() const
+{
+	return bUseBatchedEvaluation && !bUseOcclusionBuffer;
+}
+
+void UQulockComponent::HandleTraceTargetChanged(APawn* OldPawn, APawn* NewPawn)
+{
+	if (AQulockReplicationInfo* ReplicationInfo = GetReplicationSubsystem()->GetReplicationInfo())
+	{
+		ReplicationInfo->RemoveTarget(OldPawn);
+	}
+
 	UpdateTraceParams(NewPawn);
 }
+
+void UQulockComponent::HandleEnemyActivated(APawn* Enemy)
+{
+	// Enemies spawned, or brought back from the pool, after the ignore list was built wouldn't be ignored otherwise;
+	// while there's no target yet, the pending update builds the whole list anyway.
+	if (!Enemy || !TraceTarget.IsValid() || Enemy == TraceTarget.Get() || TraceParams.GetIgnoredActors().Contains(Enemy->GetUniqueID()))
+	{
+		return;
+	}
+
+	for (auto ActorClass : ActorsToIgnore)
+	{
+		if (ActorClass && Enemy->IsA(ActorClass))
+		{
+			TraceParams.AddIgnoredActor(Enemy);
+			return;
+		}
+	}
+}
+
+void UQulockComponent::HandlePostLogin(AGameModeBase* GameMode, APlayerController* NewPlayer)
+{
+	// Every world gets every login, e.g., in PIE
+	if (GameMode->GetWorld() == GetWorld())
+	{
+		SetupPlayerToCheck(NewPlayer);
+	}
+}
+
+void UQulockComponent::HandleLogout(AGameModeBase*, AController* Exiting)
+{
+	if (APlayerController* PlayerController = Cast<APlayerController>(Exiting))
+	{
+		PlayerControllerSet.Remove(PlayerController);
+		VisibilityCacheMap.Remove(PlayerController);
+	}
+}
+
+void UQulockComponent::HandleTargetTransformUpdated(USceneComponent* UpdatedComponent, EUpdateTransformFlags, ETeleportType)
+{
+	FTransform const& TargetTransform = UpdatedComponent->GetComponentTransform();
+	TargetBoundsVertexes = QulockSupportVertexKernel::MakeBoundsVertexes(TargetLocalBounds, TargetTransform);
+
+	GetBroadPhaseSubsystem()->UpdateTarget(this, FBox(TargetBoundsVertexes.GetData(), TargetBoundsVertexes.Num()));
+
+	// Frozen targets shouldn't move, but if they're moved anyway, clients still need to know where they are
+	if (!bPublishedCanMove)
+	{
+		if (AQulockReplicationInfo* ReplicationInfo = GetReplicationSubsystem()->GetReplicationInfo())
+		{
+			ReplicationInfo->NotifyTargetMoved(Cast<APawn>(UpdatedComponent->GetOwner()));
+		}
+	}
+}
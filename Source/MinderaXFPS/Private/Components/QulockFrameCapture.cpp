@@ -0,0 +1,438 @@
+// Ricardo Santos, 2023
+
+#include "Components/QulockFrameCapture.h"
+
+#include <HAL/FileManager.h>
+#include <HAL/IConsoleManager.h>
+#include <Misc/Paths.h>
+
+#include "Components/QulockInstrumentation.h"
+#include "Components/QulockSupportVertexKernel.h"
+#include "Subsystem/PlayerViewDataCachingSubsystem.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogQulockCapture, Log, All);
+
+namespace QulockFrameCapture
+{
+	FArchive& operator<<(FArchive& Ar, FCapturedView& View)
+	{
+		Ar << View.ViewProjMatrix << View.ViewOrigin << View.ViewRectangle;
+		for (FPlane& Plane : View.FrustumPlanes)
+		{
+			Ar << Plane;
+		}
+		return Ar << View.WorldRightDir << View.WorldUpDir;
+	}
+
+	FArchive& operator<<(FArchive& Ar, FCapturedTrace& Trace)
+	{
+		return Ar << Trace.End << Trace.Result;
+	}
+
+	FArchive& operator<<(FArchive& Ar, FCapturedEvaluation& Evaluation)
+	{
+		Ar << Evaluation.ViewIndex;
+		for (FVector& Vertex : Evaluation.BoundsVertexes)
+		{
+			Ar << Vertex;
+		}
+		Ar << Evaluation.SupportVertexes << Evaluation.Traces;
+
+		uint8 Flags = static_cast<uint8>(Evaluation.bIsWithinFrustum | Evaluation.bIsInView << 1);
+		Ar << Flags;
+		Evaluation.bIsWithinFrustum = Flags & 1;
+		Evaluation.bIsInView = Flags >> 1 & 1;
+		return Ar;
+	}
+
+	FArchive& operator<<(FArchive& Ar, FCapturedFrame& Frame)
+	{
+		return Ar << Frame.Frame << Frame.Views << Frame.Evaluations;
+	}
+}
+
+namespace
+{
+	using namespace QulockFrameCapture;
+
+	constexpr uint32 CaptureMagic = 0x514C4B43; // QLKC
+	constexpr uint32 CaptureVersion = 1;
+
+	// Must match UQulockComponent, otherwise every trace will be reported as a mismatch
+	constexpr float TraceTolerance = 10.f;
+	constexpr double TraceEndTolerance = 0.01;
+
+	struct FRecorder
+	{
+		TUniquePtr<FArchive> Writer;
+		FCapturedFrame CurrentFrame;
+		TMap<void const*, int32> ViewIndexMap;
+		int32 NumFrames = 0;
+
+		void Flush()
+		{
+			if (Writer && CurrentFrame.Evaluations.Num() > 0)
+			{
+				*Writer << CurrentFrame;
+				++NumFrames;
+			}
+
+			CurrentFrame.Views.Reset();
+			CurrentFrame.Evaluations.Reset();
+			ViewIndexMap.Reset();
+		}
+	};
+
+	FRecorder& GetRecorder()
+	{
+		static FRecorder Recorder;
+		return Recorder;
+	}
+
+	FVector ProjectPointOntoPlane(FVector const& Point, FVector const& PlaneOrigin, FVector const& PlaneNormal)
+	{
+		return PlaneNormal * FVector::DotProduct(PlaneOrigin - Point, PlaneNormal) + Point;
+	}
+
+	// Same decisions as IsActorWithinPlayerView, with the traces stubbed by the captured results;
+	// returns false if the traces we would have executed don't match the captured ones.
+	bool ReplayTraces(FCapturedView const& View, FCapturedEvaluation const& Evaluation,
+					  TArray<FVector> const& SupportVertexArray, bool& bOutIsInView)
+	{
+		int32 TraceIndex = 0;
+		auto Trace = [&](FVector const& End, ETraceResult& OutResult)
+		{
+			if (!Evaluation.Traces.IsValidIndex(TraceIndex) || !Evaluation.Traces[TraceIndex].End.Equals(End, TraceEndTolerance))
+			{
+				return false;
+			}
+			OutResult = Evaluation.Traces[TraceIndex++].Result;
+			return true;
+		};
+
+		bOutIsInView = false;
+		for (FVector Vertex : SupportVertexArray)
+		{
+			FVector TraceDirection = (Vertex - View.ViewOrigin).GetUnsafeNormal();
+			Vertex += TraceDirection * TraceTolerance;
+
+			ETraceResult Result;
+			if (!Trace(Vertex, Result))
+			{
+				return false;
+			}
+
+			if (Result == ETraceResult::Missed)
+			{
+				continue;
+			}
+
+			// Captures don't record the mode, so they have to be replayed with the one they were recorded with
+			bool bNewIsInView = Result == ETraceResult::HitTarget;
+			if (bNewIsInView && QulockInstrumentation::ShouldUseProjectedVertexTraces())
+			{
+				bool bShouldProject = false;
+				for (FPlane const& Plane : View.FrustumPlanes)
+				{
+					if (Plane.PlaneDot(Vertex) > 0)
+					{
+						Vertex = ProjectPointOntoPlane(Vertex, View.ViewOrigin, Plane.GetNormal());
+						bShouldProject = true;
+					}
+				}
+
+				if (bShouldProject)
+				{
+					if (!Trace(Vertex, Result))
+					{
+						return false;
+					}
+
+					if (Result != ETraceResult::Missed)
+					{
+						bNewIsInView = Result == ETraceResult::HitTarget;
+					}
+				}
+			}
+
+			if (bNewIsInView)
+			{
+				bOutIsInView = true;
+				break;
+			}
+		}
+
+		return TraceIndex == Evaluation.Traces.Num();
+	}
+
+	bool ReplayFrustum(FCapturedView const& View, FCapturedEvaluation const& Evaluation, bool bVectorized,
+					   TArray<FVector>& OutSupportVertexArray)
+	{
+		FVector SupportVertexes[4];
+		bool bIsWithinFrustum = bVectorized
+			? QulockSupportVertexKernel::ComputeVectorized(Evaluation.BoundsVertexes, View.ViewProjMatrix, View.FrustumPlanes, SupportVertexes)
+			: QulockSupportVertexKernel::ComputeScalar(Evaluation.BoundsVertexes, View.ViewProjMatrix, View.ViewRectangle, SupportVertexes);
+
+		OutSupportVertexArray.Reset();
+		if (bIsWithinFrustum)
+		{
+			// Same offsets as IsActorWithinPlayerFrustum
+			OutSupportVertexArray.Add(SupportVertexes[0] + View.WorldRightDir);
+			OutSupportVertexArray.Add(SupportVertexes[1] - View.WorldRightDir);
+			OutSupportVertexArray.Add(SupportVertexes[2] - View.WorldUpDir);
+			OutSupportVertexArray.Add(SupportVertexes[3] + View.WorldUpDir);
+		}
+
+		return bIsWithinFrustum;
+	}
+
+	void StartRecording(TArray<FString> const& Args)
+	{
+		FRecorder& Recorder = GetRecorder();
+		if (Recorder.Writer)
+		{
+			UE_LOG(LogQulockCapture, Warning, TEXT("Already recording a Qulock capture"));
+			return;
+		}
+
+		FString FilePath = Args.Num() > 0
+			? Args[0]
+			: FPaths::ProfilingDir() / TEXT("Qulock") / FString::Printf(TEXT("%s.qlkcap"), *FDateTime::Now().ToString());
+
+		Recorder.Writer.Reset(IFileManager::Get().CreateFileWriter(*FilePath));
+		if (!Recorder.Writer)
+		{
+			UE_LOG(LogQulockCapture, Error, TEXT("Couldn't open %s for writing"), *FilePath);
+			return;
+		}
+
+		uint32 Magic = CaptureMagic;
+		uint32 Version = CaptureVersion;
+		*Recorder.Writer << Magic << Version;
+
+		Recorder.NumFrames = 0;
+		UE_LOG(LogQulockCapture, Display, TEXT("Recording Qulock capture to %s"), *FilePath);
+	}
+
+	void StopRecording()
+	{
+		FRecorder& Recorder = GetRecorder();
+		if (!Recorder.Writer)
+		{
+			return;
+		}
+
+		Recorder.Flush();
+		Recorder.Writer->Close();
+		Recorder.Writer.Reset();
+
+		UE_LOG(LogQulockCapture, Display, TEXT("Recorded %d frames"), Recorder.NumFrames);
+	}
+
+	// Runs the kernels and the trace decisions against every captured evaluation,
+	// reports any evaluation whose result no longer matches the captured one, and how long each kernel took.
+	void Replay(TArray<FString> const& Args)
+	{
+		if (Args.Num() < 1)
+		{
+			UE_LOG(LogQulockCapture, Warning, TEXT("Usage: Qulock.Capture.Replay <FilePath> [NumIterations]"));
+			return;
+		}
+
+		int32 NumIterations = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 10;
+		NumIterations = FMath::Max(NumIterations, 1);
+
+		TUniquePtr<FArchive> Reader{ IFileManager::Get().CreateFileReader(*Args[0]) };
+		if (!Reader)
+		{
+			UE_LOG(LogQulockCapture, Error, TEXT("Couldn't open %s for reading"), *Args[0]);
+			return;
+		}
+
+		uint32 Magic = 0;
+		uint32 Version = 0;
+		*Reader << Magic << Version;
+		if (Magic != CaptureMagic || Version != CaptureVersion)
+		{
+			UE_LOG(LogQulockCapture, Error, TEXT("%s is not a Qulock capture, or is from another version"), *Args[0]);
+			return;
+		}
+
+		TArray<FCapturedFrame> FrameArray;
+		while (!Reader->AtEnd() && !Reader->IsError())
+		{
+			FCapturedFrame& Frame = FrameArray.AddDefaulted_GetRef();
+			*Reader << Frame;
+
+			for (FCapturedEvaluation const& Evaluation : Frame.Evaluations)
+			{
+				if (!Frame.Views.IsValidIndex(Evaluation.ViewIndex))
+				{
+					Reader->SetError();
+					break;
+				}
+			}
+		}
+
+		if (Reader->IsError())
+		{
+			UE_LOG(LogQulockCapture, Error, TEXT("%s is truncated, replaying the frames before the error"), *Args[0]);
+			FrameArray.Pop();
+		}
+
+		int32 NumEvaluations = 0;
+		int32 NumFrustumMismatches = 0;
+		int32 NumTraceMismatches = 0;
+		int32 NumResultMismatches = 0;
+
+		TArray<FVector> SupportVertexArray;
+		for (FCapturedFrame const& Frame : FrameArray)
+		{
+			for (FCapturedEvaluation const& Evaluation : Frame.Evaluations)
+			{
+				FCapturedView const& View = Frame.Views[Evaluation.ViewIndex];
+
+				bool bIsWithinFrustum = ReplayFrustum(View, Evaluation, true, SupportVertexArray);
+				bool bIsFrustumMismatch = bIsWithinFrustum != Evaluation.bIsWithinFrustum
+									   || SupportVertexArray.Num() != Evaluation.SupportVertexes.Num();
+				for (int32 Index = 0; !bIsFrustumMismatch && Index < SupportVertexArray.Num(); ++Index)
+				{
+					bIsFrustumMismatch = !SupportVertexArray[Index].Equals(Evaluation.SupportVertexes[Index]);
+				}
+
+				bool bIsInView = false;
+				bool bIsTraceMismatch = bIsWithinFrustum && !ReplayTraces(View, Evaluation, SupportVertexArray, bIsInView);
+
+				++NumEvaluations;
+				NumFrustumMismatches += bIsFrustumMismatch;
+				NumTraceMismatches += bIsTraceMismatch;
+				NumResultMismatches += !bIsTraceMismatch && bIsInView != Evaluation.bIsInView;
+			}
+		}
+
+		auto TimeReplay = [&](bool bVectorized)
+		{
+			int32 Checksum = 0;
+			double StartTime = FPlatformTime::Seconds();
+			for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+			{
+				for (FCapturedFrame const& Frame : FrameArray)
+				{
+					for (FCapturedEvaluation const& Evaluation : Frame.Evaluations)
+					{
+						FCapturedView const& View = Frame.Views[Evaluation.ViewIndex];
+
+						bool bIsInView = false;
+						if (ReplayFrustum(View, Evaluation, bVectorized, SupportVertexArray))
+						{
+							ReplayTraces(View, Evaluation, SupportVertexArray, bIsInView);
+						}
+						Checksum += bIsInView;
+					}
+				}
+			}
+			double ElapsedTime = FPlatformTime::Seconds() - StartTime;
+
+			// Keeps the compiler from discarding the replay
+			volatile int32 ChecksumSink = Checksum;
+			(void)ChecksumSink;
+
+			return ElapsedTime * 1e9 / (double(NumIterations) * FMath::Max(NumEvaluations, 1));
+		};
+
+		double ScalarNanoseconds = TimeReplay(false);
+		double VectorizedNanoseconds = TimeReplay(true);
+
+		UE_LOG(LogQulockCapture, Display, TEXT("Replayed %d frames, %d evaluations: %d frustum, %d trace and %d result mismatches"),
+			   FrameArray.Num(), NumEvaluations, NumFrustumMismatches, NumTraceMismatches, NumResultMismatches);
+		UE_LOG(LogQulockCapture, Display, TEXT("Scalar: %.1f ns/evaluation, Vectorized: %.1f ns/evaluation"),
+			   ScalarNanoseconds, VectorizedNanoseconds);
+	}
+}
+
+bool QulockFrameCapture::IsRecording()
+{
+	return GetRecorder().Writer.IsValid();
+}
+
+QulockFrameCapture::FCapturedEvaluation* QulockFrameCapture::BeginEvaluation(void const* ViewKey, FPlayerViewData const& ViewData,
+																			 TStaticArray<FVector, 8> const& BoundsVertexes)
+{
+	FRecorder& Recorder = GetRecorder();
+	if (!Recorder.Writer || !ViewData.bIsValid)
+	{
+		return nullptr;
+	}
+
+	if (Recorder.CurrentFrame.Frame != GFrameCounter)
+	{
+		Recorder.Flush();
+		Recorder.CurrentFrame.Frame = GFrameCounter;
+	}
+
+	int32* ViewIndexPtr = Recorder.ViewIndexMap.Find(ViewKey);
+	if (!ViewIndexPtr)
+	{
+		Recorder.CurrentFrame.Views.Add(CaptureView(ViewData));
+		ViewIndexPtr = &Recorder.ViewIndexMap.Add(ViewKey, Recorder.CurrentFrame.Views.Num() - 1);
+	}
+
+	FCapturedEvaluation& Evaluation = Recorder.CurrentFrame.Evaluations.AddDefaulted_GetRef();
+	Evaluation.ViewIndex = *ViewIndexPtr;
+	Evaluation.BoundsVertexes = BoundsVertexes;
+	return &Evaluation;
+}
+
+QulockFrameCapture::FCapturedView QulockFrameCapture::CaptureView(FPlayerViewData const& ViewData)
+{
+	FCapturedView View;
+	View.ViewProjMatrix = ViewData.ViewProjMatrix;
+	View.ViewOrigin = ViewData.ViewOrigin;
+	View.ViewRectangle = ViewData.ViewRectangle;
+	FMemory::Memcpy(View.FrustumPlanes, ViewData.FrustumPlanes, sizeof(View.FrustumPlanes));
+	View.WorldRightDir = ViewData.WorldRightDir;
+	View.WorldUpDir = ViewData.WorldUpDir;
+	return View;
+}
+
+void QulockFrameCapture::AddEvaluation(FCapturedView const& View, FCapturedEvaluation&& Evaluation)
+{
+	FRecorder& Recorder = GetRecorder();
+	if (!Recorder.Writer)
+	{
+		return;
+	}
+
+	if (Recorder.CurrentFrame.Frame != GFrameCounter)
+	{
+		Recorder.Flush();
+		Recorder.CurrentFrame.Frame = GFrameCounter;
+	}
+
+	int32* ViewIndexPtr = Recorder.ViewIndexMap.Find(&View);
+	if (!ViewIndexPtr)
+	{
+		Recorder.CurrentFrame.Views.Add(View);
+		ViewIndexPtr = &Recorder.ViewIndexMap.Add(&View, Recorder.CurrentFrame.Views.Num() - 1);
+	}
+
+	Evaluation.ViewIndex = *ViewIndexPtr;
+	Recorder.CurrentFrame.Evaluations.Add(MoveTemp(Evaluation));
+}
+
+// Usage: Qulock.Capture.Start [FilePath], Qulock.Capture.Stop, Qulock.Capture.Replay <FilePath> [NumIterations]
+// Both trace paths are captured, occlusion buffer evaluations aren't since they don't trace anything.
+static FAutoConsoleCommand GStartQulockCaptureCommand(
+	TEXT("Qulock.Capture.Start"),
+	TEXT("Starts recording the inputs and results of every Qulock visibility test. Usage: Qulock.Capture.Start [FilePath]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&StartRecording));
+
+static FAutoConsoleCommand GStopQulockCaptureCommand(
+	TEXT("Qulock.Capture.Stop"),
+	TEXT("Stops recording the Qulock capture."),
+	FConsoleCommandDelegate::CreateStatic(&StopRecording));
+
+static FAutoConsoleCommand GReplayQulockCaptureCommand(
+	TEXT("Qulock.Capture.Replay"),
+	TEXT("Replays a Qulock capture through both kernels, with traces stubbed by the captured results. Usage: Qulock.Capture.Replay <FilePath> [NumIterations]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&Replay));
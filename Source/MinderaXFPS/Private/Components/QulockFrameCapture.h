@@ -0,0 +1,91 @@
+// Ricardo Santos, 2023
+
+#pragma once
+
+#include <CoreMinimal.h>
+#include <Containers/StaticArray.h>
+
+// Captures are only recorded in development builds, there's no reason to pay for the checks in shipping
+#define QULOCK_WITH_FRAME_CAPTURE !UE_BUILD_SHIPPING
+
+struct FPlayerViewData;
+
+// Everything IsActorWithinPlayerView, or the batched evaluation, read and decided during one frame, so that it can be replayed without a world.
+// The file is a header followed by one FCapturedFrame after another, in the archive's binary format.
+namespace QulockFrameCapture
+{
+	enum class ETraceResult : uint8
+	{
+		Missed,
+		HitTarget,
+		HitOther,
+	};
+
+	struct FCapturedView
+	{
+		FMatrix ViewProjMatrix;
+		FVector ViewOrigin;
+		FIntRect ViewRectangle;
+		FPlane FrustumPlanes[4];
+		FVector WorldRightDir;
+		FVector WorldUpDir;
+	};
+
+	// Traces are stored in the order they were executed, projected traces right after the trace they follow
+	struct FCapturedTrace
+	{
+		FVector End;
+		ETraceResult Result;
+	};
+
+	struct FCapturedEvaluation
+	{
+		int32 ViewIndex;
+		TStaticArray<FVector, 8> BoundsVertexes;
+		TArray<FVector> SupportVertexes;
+		TArray<FCapturedTrace> Traces;
+		bool bIsWithinFrustum = false;
+		bool bIsInView = false;
+	};
+
+	struct FCapturedFrame
+	{
+		uint64 Frame = 0;
+		TArray<FCapturedView> Views;
+		TArray<FCapturedEvaluation> Evaluations;
+	};
+
+	bool IsRecording();
+
+	// Starts a new evaluation of the current frame and returns it, or nullptr when not recording;
+	// the pointer is only valid until the next evaluation begins.
+	FCapturedEvaluation* BeginEvaluation(void const* ViewKey, FPlayerViewData const& ViewData,
+										 TStaticArray<FVector, 8> const& BoundsVertexes);
+
+	FCapturedView CaptureView(FPlayerViewData const& ViewData);
+
+	// For evaluations that are resolved on a later frame than their view was captured, e.g., batched ones;
+	// evaluations of the same View (by address) share it within the current frame.
+	void AddEvaluation(FCapturedView const& View, FCapturedEvaluation&& Evaluation);
+}
+
+#if QULOCK_WITH_FRAME_CAPTURE
+#	define QULOCK_CAPTURE_DECLARE(ViewKey, ViewData, BoundsVertexes) \
+		QulockFrameCapture::FCapturedEvaluation* CapturedEvaluation = QulockFrameCapture::IsRecording()\
+			? QulockFrameCapture::BeginEvaluation(ViewKey, ViewData, BoundsVertexes) : nullptr
+#	define QULOCK_CAPTURE_FRUSTUM(bIsWithinFrustum, SupportVertexArray) \
+		if (CapturedEvaluation) { CapturedEvaluation->bIsWithinFrustum = bIsWithinFrustum;\
+								  CapturedEvaluation->SupportVertexes = SupportVertexArray; }
+#	define QULOCK_CAPTURE_TRACE(bHit, HitResult, Vertex, Actor) \
+		if (CapturedEvaluation) { CapturedEvaluation->Traces.Add({ Vertex,\
+								  !(bHit) ? QulockFrameCapture::ETraceResult::Missed\
+								  : HitResult.GetActor() == Actor ? QulockFrameCapture::ETraceResult::HitTarget\
+								  : QulockFrameCapture::ETraceResult::HitOther }); }
+#	define QULOCK_CAPTURE_RESULT(bIsInView) \
+		if (CapturedEvaluation) { CapturedEvaluation->bIsInView = bIsInView; }
+#else
+#	define QULOCK_CAPTURE_DECLARE(ViewKey, ViewData, BoundsVertexes)
+#	define QULOCK_CAPTURE_FRUSTUM(bIsWithinFrustum, SupportVertexArray)
+#	define QULOCK_CAPTURE_TRACE(bHit, HitResult, Vertex, Actor)
+#	define QULOCK_CAPTURE_RESULT(bIsInView)
+#endif
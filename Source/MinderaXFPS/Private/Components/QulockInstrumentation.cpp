@@ -0,0 +1,132 @@
+// Ricardo Santos, 2023
+
+#include "Components/QulockInstrumentation.h"
+
+#include <HAL/IConsoleManager.h>
+#include <Trace/Trace.inl>
+
+#include "Components/QulockComponent.h"
+
+// Defaults for the console variables below
+#define QULOCK_SHOULD_USE_PROJECTED_VERTEX_TRACES 1
+#define QULOCK_SHOULD_USE_VECTORIZED_SUPPORT_VERTEXES 1
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Line Traces"), STAT_QulockLineTraces, STATGROUP_QulockMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Reprojection Traces"), STAT_QulockReprojectionTraces, STATGROUP_QulockMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Frustum Rejections (Left)"), STAT_QulockLeftPlaneRejections, STATGROUP_QulockMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Frustum Rejections (Right)"), STAT_QulockRightPlaneRejections, STATGROUP_QulockMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Frustum Rejections (Top)"), STAT_QulockTopPlaneRejections, STATGROUP_QulockMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Frustum Rejections (Bottom)"), STAT_QulockBottomPlaneRejections, STATGROUP_QulockMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Frustum Rejections (Behind View)"), STAT_QulockBehindViewRejections, STATGROUP_QulockMovement);
+
+UE_TRACE_CHANNEL_DEFINE(QulockChannel);
+
+UE_TRACE_EVENT_BEGIN(Qulock, FrustumRejection)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, TargetId)
+	UE_TRACE_EVENT_FIELD(uint32, PlayerId)
+	UE_TRACE_EVENT_FIELD(int8, Plane)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(Qulock, LineTrace)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, TargetId)
+	UE_TRACE_EVENT_FIELD(uint32, PlayerId)
+	UE_TRACE_EVENT_FIELD(uint8, Result)
+	UE_TRACE_EVENT_FIELD(bool, bIsReprojection)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(Qulock, Evaluation)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, TargetId)
+	UE_TRACE_EVENT_FIELD(bool, bIsInView)
+	UE_TRACE_EVENT_FIELD(bool, bIsBatched)
+UE_TRACE_EVENT_END()
+
+namespace
+{
+	bool bUseProjectedVertexTraces = QULOCK_SHOULD_USE_PROJECTED_VERTEX_TRACES;
+	FAutoConsoleVariableRef CVarUseProjectedVertexTraces(
+		TEXT("Qulock.ProjectedVertexTraces"),
+		bUseProjectedVertexTraces,
+		TEXT("Whether support vertexes outside the view frustum are traced again, once projected onto the frustum; ")
+		TEXT("more accurate around the edges of the screen, at the cost of up to twice the traces."));
+
+	bool bUseVectorizedSupportVertexes = QULOCK_SHOULD_USE_VECTORIZED_SUPPORT_VERTEXES;
+	FAutoConsoleVariableRef CVarUseVectorizedSupportVertexes(
+		TEXT("Qulock.VectorizedSupportVertexes"),
+		bUseVectorizedSupportVertexes,
+		TEXT("Whether support vertexes are found by the vectorized kernel, otherwise by the scalar reference one."));
+
+	uint32 GetTraceId(UObject const* Object)
+	{
+		return Object ? Object->GetUniqueID() : 0;
+	}
+}
+
+bool QulockInstrumentation::ShouldUseProjectedVertexTraces()
+{
+	return bUseProjectedVertexTraces;
+}
+
+bool QulockInstrumentation::ShouldUseVectorizedSupportVertexes()
+{
+	return bUseVectorizedSupportVertexes;
+}
+
+void QulockInstrumentation::CountTraces(int32 const NumTraces, int32 const NumReprojectionTraces)
+{
+	INC_DWORD_STAT_BY(STAT_QulockLineTraces, NumTraces);
+	INC_DWORD_STAT_BY(STAT_QulockReprojectionTraces, NumReprojectionTraces);
+
+	CSV_CUSTOM_STAT(Qulock, Traces, NumTraces, ECsvCustomStatOp::Accumulate);
+	CSV_CUSTOM_STAT(Qulock, ReprojectionTraces, NumReprojectionTraces, ECsvCustomStatOp::Accumulate);
+}
+
+void QulockInstrumentation::TraceFrustumRejection(UObject const* Target, UObject const* Player, int32 const RejectingPlane)
+{
+	switch (RejectingPlane)
+	{
+		case 0:
+			INC_DWORD_STAT(STAT_QulockLeftPlaneRejections);
+			break;
+		case 1:
+			INC_DWORD_STAT(STAT_QulockRightPlaneRejections);
+			break;
+		case 2:
+			INC_DWORD_STAT(STAT_QulockTopPlaneRejections);
+			break;
+		case 3:
+			INC_DWORD_STAT(STAT_QulockBottomPlaneRejections);
+			break;
+		default:
+			INC_DWORD_STAT(STAT_QulockBehindViewRejections);
+			break;
+	}
+
+	UE_TRACE_LOG(Qulock, FrustumRejection, QulockChannel)
+		<< FrustumRejection.Cycle(FPlatformTime::Cycles64())
+		<< FrustumRejection.TargetId(GetTraceId(Target))
+		<< FrustumRejection.PlayerId(GetTraceId(Player))
+		<< FrustumRejection.Plane(static_cast<int8>(RejectingPlane));
+}
+
+void QulockInstrumentation::TraceLineTrace(UObject const* Target, UObject const* Player, ETraceResult const Result,
+										   bool const bIsReprojection)
+{
+	UE_TRACE_LOG(Qulock, LineTrace, QulockChannel)
+		<< LineTrace.Cycle(FPlatformTime::Cycles64())
+		<< LineTrace.TargetId(GetTraceId(Target))
+		<< LineTrace.PlayerId(GetTraceId(Player))
+		<< LineTrace.Result(static_cast<uint8>(Result))
+		<< LineTrace.bIsReprojection(bIsReprojection);
+}
+
+void QulockInstrumentation::TraceEvaluation(UObject const* Target, bool const bIsInView, bool const bIsBatched)
+{
+	UE_TRACE_LOG(Qulock, Evaluation, QulockChannel)
+		<< Evaluation.Cycle(FPlatformTime::Cycles64())
+		<< Evaluation.TargetId(GetTraceId(Target))
+		<< Evaluation.bIsInView(bIsInView)
+		<< Evaluation.bIsBatched(bIsBatched);
+}
@@ -0,0 +1,37 @@
+// Ricardo Santos, 2023
+
+#pragma once
+
+#include <CoreMinimal.h>
+#include <ProfilingDebugging/CpuProfilerTrace.h>
+#include <Trace/Trace.h>
+
+// Qulock events for Unreal Insights, enabled with -trace=default,qulock (or Trace.Enable qulock)
+UE_TRACE_CHANNEL_EXTERN(QulockChannel);
+
+// Everything we need to tell where the Qulock evaluation spends its time, and what it decides, in a running build:
+// counters in STATGROUP_QulockMovement, stats in the Qulock CSV category, and per-target events on QulockChannel.
+namespace QulockInstrumentation
+{
+	enum class ETraceResult : uint8
+	{
+		Missed,
+		HitTarget,
+		HitOther,
+		Unavailable, // Async trace data that was already discarded
+	};
+
+	// Runtime switches for what used to be compile-time only, so we can A/B the cost against the accuracy
+	bool ShouldUseProjectedVertexTraces();
+	bool ShouldUseVectorizedSupportVertexes();
+
+	void CountTraces(int32 NumTraces, int32 NumReprojectionTraces);
+
+	// RejectingPlane is the index of the plane in FPlayerViewData::FrustumPlanes, or INDEX_NONE if the target is behind the view
+	void TraceFrustumRejection(UObject const* Target, UObject const* Player, int32 RejectingPlane);
+
+	// Player is null for batched traces, which aren't evaluated per player
+	void TraceLineTrace(UObject const* Target, UObject const* Player, ETraceResult Result, bool bIsReprojection);
+
+	void TraceEvaluation(UObject const* Target, bool bIsInView, bool bIsBatched);
+}
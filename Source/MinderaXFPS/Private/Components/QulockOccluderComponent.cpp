@@ -0,0 +1,88 @@
+// Ricardo Santos, 2023
+
+#include "Components/QulockOccluderComponent.h"
+
+#include "Components/QulockSupportVertexKernel.h"
+#include "Subsystem/QulockOcclusionSubsystem.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogQulockOccluder, Log, All);
+
+namespace
+{
+	// Boxes added in the details panel are never flagged as valid, so it's their extents that tell
+	bool IsOccluderBoxValid(FBox const& OccluderBox)
+	{
+		return OccluderBox.Min.ComponentwiseAllLessThan(OccluderBox.Max);
+	}
+}
+
+UQulockOccluderComponent::UQulockOccluderComponent(FObjectInitializer const& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryComponentTick.bCanEverTick = false;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+}
+
+void UQulockOccluderComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	USceneComponent* RootComponent = GetOwner()->GetRootComponent();
+	if (!RootComponent || !GetWorld()->GetSubsystem<UQulockOcclusionSubsystem>())
+	{
+		return;
+	}
+
+	if (!OccluderBoxArray.ContainsByPredicate(&IsOccluderBoxValid))
+	{
+		UE_LOG(LogQulockOccluder, Warning, TEXT("%s has no occluder boxes with any volume, it won't occlude anything"), *GetFullName());
+		return;
+	}
+
+	// Occluders that move, e.g., doors, keep their boxes where they are
+	OwnerRootComponent = RootComponent;
+	OwnerTransformUpdatedHandle = RootComponent->TransformUpdated.AddUObject(this, &UQulockOccluderComponent::HandleOwnerTransformUpdated);
+
+	HandleOwnerTransformUpdated(RootComponent, EUpdateTransformFlags::None, ETeleportType::None);
+}
+
+void UQulockOccluderComponent::EndPlay(EEndPlayReason::Type const EndPlayReason)
+{
+	if (USceneComponent* RootComponent = OwnerRootComponent.Get())
+	{
+		RootComponent->TransformUpdated.Remove(OwnerTransformUpdatedHandle);
+	}
+
+	OwnerRootComponent.Reset();
+	OwnerTransformUpdatedHandle.Reset();
+
+	if (auto OcclusionSubsystem = GetWorld()->GetSubsystem<UQulockOcclusionSubsystem>())
+	{
+		OcclusionSubsystem->UnregisterOccluder(this);
+	}
+	
+	Super::EndPlay(EndPlayReason);
+}
+
+void UQulockOccluderComponent::HandleOwnerTransformUpdated(USceneComponent* UpdatedComponent, EUpdateTransformFlags, ETeleportType)
+{
+	auto OcclusionSubsystem = GetWorld()->GetSubsystem<UQulockOcclusionSubsystem>();
+	if (!OcclusionSubsystem)
+	{
+		return;
+	}
+
+	FTransform const& OwnerTransform = UpdatedComponent->GetComponentTransform();
+
+	TArray<TStaticArray<FVector, 8>> OccluderVertexesArray;
+	OccluderVertexesArray.Reserve(OccluderBoxArray.Num());
+	for (FBox const& OccluderBox : OccluderBoxArray)
+	{
+		if (IsOccluderBoxValid(OccluderBox))
+		{
+			OccluderVertexesArray.Add(QulockSupportVertexKernel::MakeBoundsVertexes(OccluderBox, OwnerTransform));
+		}
+	}
+
+	OcclusionSubsystem->RegisterOccluder(this, MoveTemp(OccluderVertexesArray));
+}
@@ -0,0 +1,372 @@
+// Ricardo Santos, 2023
+
+#include "Components/QulockSupportVertexKernel.h"
+
+#include <SceneView.h>
+#include <HAL/IConsoleManager.h>
+#include <Math/InverseRotationMatrix.h>
+#include <Math/PerspectiveMatrix.h>
+#include <Math/TranslationMatrix.h>
+
+DEFINE_LOG_CATEGORY_STATIC(LogQulockKernel, Log, All);
+
+namespace
+{
+	FVector ComputeProjectedSupportVertex(TStaticArray<FVector, 8> const& PolyVertexes,
+										  FMatrix const& ViewProjMat, FIntRect const& ViewRect,
+										  FVector2D const& Direction)
+	{
+		float MaxProjection = -TNumericLimits<float>::Max();
+
+		FVector SupportVertex;
+		for (FVector const& Vertex : PolyVertexes)
+		{
+			FVector2D ScreenVertex;
+			FSceneView::ProjectWorldToScreen(Vertex, ViewRect, ViewProjMat, ScreenVertex);
+
+			float Projection = Direction.Dot(ScreenVertex);
+			if (Projection > MaxProjection)
+			{
+				MaxProjection = Projection;
+				SupportVertex = Vertex;
+			}
+		}
+
+		return SupportVertex;
+	}
+
+	FORCEINLINE VectorRegister4Double SplatDouble(double Value)
+	{
+		return MakeVectorRegisterDouble(Value, Value, Value, Value);
+	}
+}
+
+TStaticArray<FVector, 8> QulockSupportVertexKernel::MakeBoundsVertexes(FBox const& Bounds)
+{
+	return MakeBoundsVertexes(Bounds, FTransform::Identity);
+}
+
+TStaticArray<FVector, 8> QulockSupportVertexKernel::MakeBoundsVertexes(FBox const& LocalBounds, FTransform const& Transform)
+{
+	FVector BoundsPos = LocalBounds.GetCenter();
+	FVector BoundsSizeAbs = LocalBounds.GetExtent();
+
+	TStaticArray<FVector, 8> BoundsVertexes;
+	for (int32 Index = 0; Index < 8; ++Index)
+	{
+		FVector LocalVertex = BoundsPos + FVector((Index & 4) ? -BoundsSizeAbs.X : BoundsSizeAbs.X,
+												  (Index & 2) ? -BoundsSizeAbs.Y : BoundsSizeAbs.Y,
+												  (Index & 1) ? -BoundsSizeAbs.Z : BoundsSizeAbs.Z);
+
+		BoundsVertexes[Index] = Transform.TransformPosition(LocalVertex);
+	}
+
+	return BoundsVertexes;
+}
+
+bool QulockSupportVertexKernel::ComputeScalar(TStaticArray<FVector, 8> const& BoundsVertexes, FMatrix const& ViewProjMat,
+											  FIntRect const& ViewRect, FVector (&OutSupportVertexes)[4], int32* OutRejectingPlane)
+{
+	static FVector2D ScreenLeftDir(-1.f, 0.f);
+	static FVector2D ScreenRightDir(+1.f, 0.f);
+	static FVector2D ScreenUpDir(0.f, -1.f);
+	static FVector2D ScreenDownDir(0.f, +1.f);
+
+	FPlane RightPlane;
+	ViewProjMat.GetFrustumRightPlane(RightPlane);
+
+	FVector LeftSupportVertex = ComputeProjectedSupportVertex(BoundsVertexes, ViewProjMat,
+															  ViewRect, ScreenLeftDir);
+
+	float LeftSignedDistance = RightPlane.PlaneDot(LeftSupportVertex);
+	if (LeftSignedDistance > 0)
+	{
+		if (OutRejectingPlane)
+		{
+			*OutRejectingPlane = 1;
+		}
+		return false;
+	}
+
+	FPlane LeftPlane;
+	ViewProjMat.GetFrustumLeftPlane(LeftPlane);
+
+	FVector RightSupportVertex = ComputeProjectedSupportVertex(BoundsVertexes, ViewProjMat,
+															   ViewRect, ScreenRightDir);
+
+	float RightSignedDistance = LeftPlane.PlaneDot(RightSupportVertex);
+	if (RightSignedDistance > 0)
+	{
+		if (OutRejectingPlane)
+		{
+			*OutRejectingPlane = 0;
+		}
+		return false;
+	}
+
+	FPlane BottomPlane;
+	ViewProjMat.GetFrustumBottomPlane(BottomPlane);
+
+	FVector TopSupportVertex = ComputeProjectedSupportVertex(BoundsVertexes, ViewProjMat,
+															 ViewRect, ScreenUpDir);
+
+	float TopSignedDistance = BottomPlane.PlaneDot(TopSupportVertex);
+	if (TopSignedDistance > 0)
+	{
+		if (OutRejectingPlane)
+		{
+			*OutRejectingPlane = 3;
+		}
+		return false;
+	}
+
+	FPlane TopPlane;
+	ViewProjMat.GetFrustumTopPlane(TopPlane);
+
+	FVector BottomSupportVertex = ComputeProjectedSupportVertex(BoundsVertexes, ViewProjMat,
+																ViewRect, ScreenDownDir);
+
+	float BottomSignedDistance = TopPlane.PlaneDot(BottomSupportVertex);
+	if (BottomSignedDistance > 0)
+	{
+		if (OutRejectingPlane)
+		{
+			*OutRejectingPlane = 2;
+		}
+		return false;
+	}
+
+	OutSupportVertexes[0] = LeftSupportVertex;
+	OutSupportVertexes[1] = RightSupportVertex;
+	OutSupportVertexes[2] = TopSupportVertex;
+	OutSupportVertexes[3] = BottomSupportVertex;
+
+	return true;
+}
+
+bool QulockSupportVertexKernel::ComputeVectorized(TStaticArray<FVector, 8> const& BoundsVertexes, FMatrix const& ViewProjMat,
+												  FPlane const (&FrustumPlanes)[4], FVector (&OutSupportVertexes)[4],
+												  int32* OutRejectingPlane)
+{
+	if (!ProjectSupportVertexesVectorized(BoundsVertexes, ViewProjMat, OutSupportVertexes))
+	{
+		if (OutRejectingPlane)
+		{
+			*OutRejectingPlane = INDEX_NONE;
+		}
+		return false;
+	}
+
+	return TestFrustumPlanesVectorized(OutSupportVertexes, FrustumPlanes, OutRejectingPlane);
+}
+
+bool QulockSupportVertexKernel::ProjectSupportVertexesVectorized(TStaticArray<FVector, 8> const& BoundsVertexes, FMatrix const& ViewProjMat,
+																 FVector (&OutSupportVertexes)[4])
+{
+	// Left, right, top and bottom support vertexes;
+	// NDC Y points up while screen Y points down, hence top maximizes +Y.
+	int32 SupportIndexes[4] = { INDEX_NONE, INDEX_NONE, INDEX_NONE, INDEX_NONE };
+
+	// We only need clip space X, Y and W, the screen's direction is all that matters for the support vertexes,
+	// so there's no need to map them to the view rectangle like FSceneView::ProjectWorldToScreen does.
+	alignas(32) double NdcX[8];
+	alignas(32) double NdcY[8];
+	alignas(32) double ClipW[8];
+
+	for (int32 Half = 0; Half < 2; ++Half)
+	{
+		FVector const* Vertexes = &BoundsVertexes[Half * 4];
+
+		VectorRegister4Double const VertexX = MakeVectorRegisterDouble(Vertexes[0].X, Vertexes[1].X, Vertexes[2].X, Vertexes[3].X);
+		VectorRegister4Double const VertexY = MakeVectorRegisterDouble(Vertexes[0].Y, Vertexes[1].Y, Vertexes[2].Y, Vertexes[3].Y);
+		VectorRegister4Double const VertexZ = MakeVectorRegisterDouble(Vertexes[0].Z, Vertexes[1].Z, Vertexes[2].Z, Vertexes[3].Z);
+
+		auto TransformColumn = [&ViewProjMat, &VertexX, &VertexY, &VertexZ](int32 Column)
+		{
+			VectorRegister4Double Result = SplatDouble(ViewProjMat.M[3][Column]);
+			Result = VectorMultiplyAdd(VertexZ, SplatDouble(ViewProjMat.M[2][Column]), Result);
+			Result = VectorMultiplyAdd(VertexY, SplatDouble(ViewProjMat.M[1][Column]), Result);
+			Result = VectorMultiplyAdd(VertexX, SplatDouble(ViewProjMat.M[0][Column]), Result);
+			return Result;
+		};
+
+		VectorRegister4Double const HalfClipX = TransformColumn(0);
+		VectorRegister4Double const HalfClipY = TransformColumn(1);
+		VectorRegister4Double const HalfClipW = TransformColumn(3);
+
+		VectorStore(VectorDivide(HalfClipX, HalfClipW), &NdcX[Half * 4]);
+		VectorStore(VectorDivide(HalfClipY, HalfClipW), &NdcY[Half * 4]);
+		VectorStore(HalfClipW, &ClipW[Half * 4]);
+	}
+
+	// All four directions in a single pass
+	double MaxProjections[4] = { -TNumericLimits<double>::Max(), -TNumericLimits<double>::Max(),
+								 -TNumericLimits<double>::Max(), -TNumericLimits<double>::Max() };
+
+	for (int32 Index = 0; Index < 8; ++Index)
+	{
+		if (ClipW[Index] <= 0.0)
+		{
+			continue;
+		}
+
+		double const Projections[4] = { -NdcX[Index], +NdcX[Index], +NdcY[Index], -NdcY[Index] };
+		for (int32 Direction = 0; Direction < 4; ++Direction)
+		{
+			if (Projections[Direction] > MaxProjections[Direction])
+			{
+				MaxProjections[Direction] = Projections[Direction];
+				SupportIndexes[Direction] = Index;
+			}
+		}
+	}
+
+	if (SupportIndexes[0] == INDEX_NONE)
+	{
+		return false;
+	}
+
+	for (int32 Direction = 0; Direction < 4; ++Direction)
+	{
+		OutSupportVertexes[Direction] = BoundsVertexes[SupportIndexes[Direction]];
+	}
+
+	return true;
+}
+
+bool QulockSupportVertexKernel::TestFrustumPlanesVectorized(FVector const (&SupportVertexes)[4], FPlane const (&FrustumPlanes)[4],
+															int32* OutRejectingPlane)
+{
+	// Each support vertex is tested against the opposite plane
+	int32 const OppositePlaneIndexes[4] = { 1, 0, 3, 2 };
+	FPlane const OppositePlanes[4] = { FrustumPlanes[1], FrustumPlanes[0], FrustumPlanes[3], FrustumPlanes[2] };
+
+	auto MakeLanes = [](auto const& Array, auto Getter)
+	{
+		return MakeVectorRegisterDouble(Getter(Array[0]), Getter(Array[1]), Getter(Array[2]), Getter(Array[3]));
+	};
+
+	VectorRegister4Double SignedDistances = VectorMultiply(MakeLanes(SupportVertexes, [](FVector const& Vertex){ return Vertex.X; }),
+														   MakeLanes(OppositePlanes, [](FPlane const& Plane){ return Plane.X; }));
+	SignedDistances = VectorMultiplyAdd(MakeLanes(SupportVertexes, [](FVector const& Vertex){ return Vertex.Y; }),
+										MakeLanes(OppositePlanes, [](FPlane const& Plane){ return Plane.Y; }), SignedDistances);
+	SignedDistances = VectorMultiplyAdd(MakeLanes(SupportVertexes, [](FVector const& Vertex){ return Vertex.Z; }),
+										MakeLanes(OppositePlanes, [](FPlane const& Plane){ return Plane.Z; }), SignedDistances);
+	SignedDistances = VectorSubtract(SignedDistances, MakeLanes(OppositePlanes, [](FPlane const& Plane){ return Plane.W; }));
+
+	alignas(32) double SignedDistanceArray[4];
+	VectorStore(SignedDistances, SignedDistanceArray);
+
+	// Same order as the scalar kernel, so both report the same plane
+	for (int32 Direction = 0; Direction < 4; ++Direction)
+	{
+		if (SignedDistanceArray[Direction] > 0.0)
+		{
+			if (OutRejectingPlane)
+			{
+				*OutRejectingPlane = OppositePlaneIndexes[Direction];
+			}
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Microbenchmark for both kernels, runs against a synthetic view, so it works without any player or map loaded.
+// Usage: Qulock.BenchmarkSupportVertexKernel [NumIterations]
+static FAutoConsoleCommand GBenchmarkSupportVertexKernelCommand(
+	TEXT("Qulock.BenchmarkSupportVertexKernel"),
+	TEXT("Compares the scalar and vectorized Qulock support vertex kernels. Usage: Qulock.BenchmarkSupportVertexKernel [NumIterations]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](TArray<FString> const& Args)
+	{
+		int32 NumIterations = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100;
+		NumIterations = FMath::Max(NumIterations, 1);
+
+		constexpr int32 NumBounds = 1024;
+		constexpr float HalfFOV = PI / 4.f;
+		FIntRect const ViewRect{ 0, 0, 1920, 1080 };
+
+		// Same conventions as FSceneView: UE's world axes are remapped to the view's axes before projection
+		FVector const ViewOrigin = FVector::ZeroVector;
+		FRotator const ViewRotation = FRotator::ZeroRotator;
+		FMatrix const ViewMatrix = FTranslationMatrix(-ViewOrigin)
+								 * FInverseRotationMatrix(ViewRotation)
+								 * FMatrix(FPlane(0, 0, 1, 0), FPlane(1, 0, 0, 0), FPlane(0, 1, 0, 0), FPlane(0, 0, 0, 1));
+		FMatrix const ProjMatrix = FReversedZPerspectiveMatrix(HalfFOV, ViewRect.Width(), ViewRect.Height(), 10.f);
+		FMatrix const ViewProjMat = ViewMatrix * ProjMatrix;
+
+		FPlane FrustumPlanes[4];
+		ViewProjMat.GetFrustumLeftPlane(FrustumPlanes[0]);
+		ViewProjMat.GetFrustumRightPlane(FrustumPlanes[1]);
+		ViewProjMat.GetFrustumTopPlane(FrustumPlanes[2]);
+		ViewProjMat.GetFrustumBottomPlane(FrustumPlanes[3]);
+
+		FRandomStream RandomStream{ NumBounds };
+
+		TArray<TStaticArray<FVector, 8>> BoundsArray;
+		BoundsArray.Reserve(NumBounds);
+		for (int32 Index = 0; Index < NumBounds; ++Index)
+		{
+			FVector Center = RandomStream.GetUnitVector() * RandomStream.FRandRange(100.f, 5000.f);
+			FVector Extent = FVector{ RandomStream.FRandRange(20.f, 200.f) };
+			FRotator Rotation = FRotator{ 0.f, RandomStream.FRandRange(0.f, 360.f), 0.f };
+			BoundsArray.Add(QulockSupportVertexKernel::MakeBoundsVertexes(FBox::BuildAABB(FVector::ZeroVector, Extent),
+																		  FTransform{ Rotation, Center }));
+		}
+
+		int32 NumInFrustum = 0;
+		int32 NumMismatches = 0;
+		for (TStaticArray<FVector, 8> const& Bounds : BoundsArray)
+		{
+			FVector ScalarVertexes[4];
+			FVector VectorizedVertexes[4];
+			bool bScalarResult = QulockSupportVertexKernel::ComputeScalar(Bounds, ViewProjMat, ViewRect, ScalarVertexes);
+			bool bVectorizedResult = QulockSupportVertexKernel::ComputeVectorized(Bounds, ViewProjMat, FrustumPlanes, VectorizedVertexes);
+
+			bool bIsMismatch = bScalarResult != bVectorizedResult;
+			for (int32 Direction = 0; bScalarResult && !bIsMismatch && Direction < 4; ++Direction)
+			{
+				bIsMismatch = !ScalarVertexes[Direction].Equals(VectorizedVertexes[Direction]);
+			}
+
+			NumInFrustum += bScalarResult;
+			NumMismatches += bIsMismatch;
+		}
+
+		auto TimeKernel = [&](auto&& Kernel)
+		{
+			int32 Checksum = 0;
+			double StartTime = FPlatformTime::Seconds();
+			for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+			{
+				for (TStaticArray<FVector, 8> const& Bounds : BoundsArray)
+				{
+					FVector SupportVertexes[4];
+					Checksum += Kernel(Bounds, SupportVertexes);
+				}
+			}
+			double ElapsedTime = FPlatformTime::Seconds() - StartTime;
+
+			// Keeps the compiler from discarding the kernel calls
+			volatile int32 ChecksumSink = Checksum;
+			(void)ChecksumSink;
+
+			return ElapsedTime * 1e9 / (double(NumIterations) * NumBounds);
+		};
+
+		double ScalarNanoseconds = TimeKernel([&](TStaticArray<FVector, 8> const& Bounds, FVector (&SupportVertexes)[4])
+		{
+			return QulockSupportVertexKernel::ComputeScalar(Bounds, ViewProjMat, ViewRect, SupportVertexes);
+		});
+		double VectorizedNanoseconds = TimeKernel([&](TStaticArray<FVector, 8> const& Bounds, FVector (&SupportVertexes)[4])
+		{
+			return QulockSupportVertexKernel::ComputeVectorized(Bounds, ViewProjMat, FrustumPlanes, SupportVertexes);
+		});
+
+		UE_LOG(LogQulockKernel, Display, TEXT("Support vertex kernel: %d bounds x %d iterations, %d in frustum, %d mismatches"),
+			   NumBounds, NumIterations, NumInFrustum, NumMismatches);
+		UE_LOG(LogQulockKernel, Display, TEXT("Scalar: %.1f ns/bounds, Vectorized: %.1f ns/bounds (%.2fx)"),
+			   ScalarNanoseconds, VectorizedNanoseconds, ScalarNanoseconds / FMath::Max(VectorizedNanoseconds, UE_DOUBLE_SMALL_NUMBER));
+	})
+);
@@ -0,0 +1,38 @@
+// Ricardo Santos, 2023
+
+#pragma once
+
+#include <CoreMinimal.h>
+#include <Containers/StaticArray.h>
+
+// Both kernels find the support vertexes of the bounds for each screen direction (left, right, top, bottom),
+// and test each of them against the opposite frustum plane (right, left, bottom, top).
+// They return false as soon as any support vertex is beyond its plane, i.e., the bounds are outside the frustum,
+// otherwise OutSupportVertexes holds the left, right, top and bottom support vertexes, in that order.
+// The bounds are given by their 8 vertexes, so they can be oriented boxes, not only axis-aligned ones;
+// by convention, bit 2 of the vertex index flips X, bit 1 flips Y and bit 0 flips Z.
+// When rejected, OutRejectingPlane is the index of the plane that rejected the bounds, in left, right, top, bottom order,
+// or INDEX_NONE if the bounds are entirely behind the view.
+namespace QulockSupportVertexKernel
+{
+	TStaticArray<FVector, 8> MakeBoundsVertexes(FBox const& Bounds);
+	TStaticArray<FVector, 8> MakeBoundsVertexes(FBox const& LocalBounds, FTransform const& Transform);
+
+	// Reference implementation, projects every vertex of the bounds once per screen direction
+	bool ComputeScalar(TStaticArray<FVector, 8> const& BoundsVertexes, FMatrix const& ViewProjMat, FIntRect const& ViewRect,
+					   FVector (&OutSupportVertexes)[4], int32* OutRejectingPlane = nullptr);
+
+	// Projects every vertex of the bounds once, in a structure-of-arrays layout,
+	// and tests all support vertexes against their planes at the same time;
+	// vertexes behind the view are ignored, since they have no meaningful projection.
+	// FrustumPlanes are the left, right, top and bottom planes of ViewProjMat, in that order.
+	bool ComputeVectorized(TStaticArray<FVector, 8> const& BoundsVertexes, FMatrix const& ViewProjMat,
+						   FPlane const (&FrustumPlanes)[4], FVector (&OutSupportVertexes)[4], int32* OutRejectingPlane = nullptr);
+
+	// Both stages of ComputeVectorized, for callers that time them separately;
+	// the first one only fails when the bounds are entirely behind the view.
+	bool ProjectSupportVertexesVectorized(TStaticArray<FVector, 8> const& BoundsVertexes, FMatrix const& ViewProjMat,
+										  FVector (&OutSupportVertexes)[4]);
+	bool TestFrustumPlanesVectorized(FVector const (&SupportVertexes)[4], FPlane const (&FrustumPlanes)[4],
+									 int32* OutRejectingPlane = nullptr);
+}
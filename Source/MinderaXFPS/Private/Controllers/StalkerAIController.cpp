@@ -2,32 +2,53 @@
 
 #include "Controllers/StalkerAIController.h"
 
+#include <GameFramework/Character.h>
+#include <GameFramework/CharacterMovementComponent.h>
+#include <GameFramework/PawnMovementComponent.h>
+#include <Navigation/PathFollowingComponent.h>
+
 #include "Components/QulockComponent.h"
+#include "Subsystem/FlowFieldNavigationSubsystem.h"
 
 AStalkerAIController::AStalkerAIController(FObjectInitializer const& ObjectInitializer)
 	: Super(ObjectInitializer)
 	, QulockComponent(ObjectInitializer.CreateDefaultSubobject<UQulockComponent>(this, TEXT("Qulock")))
 	, bCachedCanMove(false)
 {
+	// Nothing to poll, the Qulock component tells us when we can or can't move,
+	// but AAIController still needs to tick to update the control rotation towards its focus.
 	PrimaryActorTick.bCanEverTick = true;
 	PrimaryActorTick.bStartWithTickEnabled = true;
 }
 
-void AStalkerAIController::Tick(float DeltaSeconds)
+void AStalkerAIController::BeginPlay()
 {
-	Super::Tick(DeltaSeconds);
+	Super::BeginPlay();
 
-	bool bCanMove = QulockComponent->CanMoveThisFrame();
+	QulockComponent->OnCanMoveChanged.AddDynamic(this, &AStalkerAIController::HandleCanMoveChanged);
+}
 
-	bool bCanMoveStateChanged = bCanMove != bCachedCanMove;
-	bCachedCanMove = bCanMove;
+void AStalkerAIController::EndPlay(EEndPlayReason::Type const EndPlayReason)
+{
+	StopFollowingFlowField();
 	
-	if (bShouldInterruptMoveTo && bCanMoveStateChanged && !bCanMove && IsMoveToInProgress())
-	{
-		InterruptMoveTo();
-		
-		OnMoveToInterrupted();
-	}
+	Super::EndPlay(EndPlayReason);
+}
+
+void AStalkerAIController::OnPossess(APawn* InPawn)
+{
+	Super::OnPossess(InPawn);
+
+	SetPawnSuspended(InPawn, bShouldSuspendWhenFrozen && !bCachedCanMove);
+}
+
+void AStalkerAIController::OnUnPossess()
+{
+	// Whoever possesses the pawn next expects it as we found it
+	SetPawnSuspended(GetPawn(), false);
+	StopFollowingFlowField();
+	
+	Super::OnUnPossess();
 }
 
 void AStalkerAIController::InterruptMoveTo()
@@ -45,3 +66,152 @@ bool AStalkerAIController::CanExecuteMoveTo() const
 {
 	return bCachedCanMove;
 }
+
+void AStalkerAIController::FollowFlowFieldTo(AActor* Goal)
+{
+	if (Goal)
+	{
+		GetFlowFieldSubsystem()->StartFollowing(this, Goal);
+	}
+}
+
+void AStalkerAIController::StopFollowingFlowField()
+{
+	if (UFlowFieldNavigationSubsystem* FlowField = GetFlowFieldSubsystem())
+	{
+		FlowField->StopFollowing(this);
+	}
+}
+
+bool AStalkerAIController::IsFollowingFlowField() const
+{
+	UFlowFieldNavigationSubsystem* FlowField = GetFlowFieldSubsystem();
+	return FlowField && FlowField->IsFollowing(this);
+}
+
+void AStalkerAIController::HandleCanMoveChanged(bool bCanMove)
+{
+	bCachedCanMove = bCanMove;
+	
+	if (bShouldInterruptMoveTo && !bCanMove && IsMoveToInProgress())
+	{
+		InterruptMoveTo();
+		
+		OnMoveToInterrupted();
+	}
+
+	// Flow field followers are steered after every tick group, so the step they were given last frame is still pending,
+	// and movement would take it on its next tick, or as soon as it's resumed, even though we can't move anymore.
+	if (!bCanMove && IsFollowingFlowField())
+	{
+		StopFlowFieldStep();
+	}
+
+	if (bShouldSuspendWhenFrozen)
+	{
+		SetPawnSuspended(GetPawn(), !bCanMove);
+	}
+
+	OnCanMoveChangedNative.Broadcast(bCanMove);
+	OnCanMoveChanged.Broadcast(bCanMove);
+}
+
+void AStalkerAIController::StopFlowFieldStep()
+{
+	APawn* ControlledPawn = GetPawn();
+	if (!ControlledPawn)
+	{
+		return;
+	}
+
+	ControlledPawn->ConsumeMovementInputVector();
+
+	// A stalker frozen mid-air keeps falling, but one on the ground shouldn't slide until it's done braking
+	UPawnMovementComponent* MovementComponent = ControlledPawn->GetMovementComponent();
+	if (MovementComponent && !MovementComponent->IsFalling())
+	{
+		MovementComponent->StopMovementImmediately();
+	}
+}
+
+void AStalkerAIController::SetPawnSuspended(APawn* TargetPawn, bool bSuspended)
+{
+	if (!TargetPawn || bSuspended == bIsPawnSuspended)
+	{
+		return;
+	}
+
+	bIsPawnSuspended = bSuspended;
+
+	// Disabling the ticks keeps the state of each component as is,
+	// so there's nothing to restore when they're enabled again, and the mesh doesn't pop.
+	if (UPathFollowingComponent* PathFollowingComponent = GetPathFollowingComponent())
+	{
+		PathFollowingComponent->SetComponentTickEnabled(!bSuspended);
+	}
+
+	ACharacter* Character = Cast<ACharacter>(TargetPawn);
+	if (!Character)
+	{
+		return;
+	}
+
+	if (UCharacterMovementComponent* MovementComponent = Character->GetCharacterMovement())
+	{
+		// A stalker frozen mid-air keeps falling, and its movement is suspended when it lands, if it's still frozen by then
+		if (bSuspended && !MovementComponent->IsMovingOnGround())
+		{
+			Character->LandedDelegate.AddUniqueDynamic(this, &AStalkerAIController::HandlePawnLanded);
+		}
+		else
+		{
+			Character->LandedDelegate.RemoveDynamic(this, &AStalkerAIController::HandlePawnLanded);
+			MovementComponent->SetComponentTickEnabled(!bSuspended);
+		}
+	}
+
+	if (USkeletalMeshComponent* MeshComponent = Character->GetMesh())
+	{
+		if (FrozenMeshTickInterval > 0.f)
+		{
+			if (bSuspended)
+			{
+				UnfrozenMeshTickInterval = MeshComponent->GetComponentTickInterval();
+			}
+			MeshComponent->SetComponentTickInterval(bSuspended ? FrozenMeshTickInterval : UnfrozenMeshTickInterval);
+		}
+		else if (bSuspended)
+		{
+			bWasMeshTickEnabled = MeshComponent->IsComponentTickEnabled();
+			MeshComponent->SetComponentTickEnabled(false);
+		}
+		else
+		{
+			MeshComponent->SetComponentTickEnabled(bWasMeshTickEnabled);
+		}
+	}
+}
+
+void AStalkerAIController::HandlePawnLanded(FHitResult const& Hit)
+{
+	ACharacter* Character = Cast<ACharacter>(GetPawn());
+	if (!Character)
+	{
+		return;
+	}
+
+	Character->LandedDelegate.RemoveDynamic(this, &AStalkerAIController::HandlePawnLanded);
+
+	UCharacterMovementComponent* MovementComponent = Character->GetCharacterMovement();
+	if (MovementComponent && bIsPawnSuspended)
+	{
+		MovementComponent->SetComponentTickEnabled(false);
+	}
+}
+
+UFlowFieldNavigationSubsystem* AStalkerAIController::GetFlowFieldSubsystem() const
+{
+	return FlowFieldSubsystem
+		 ? FlowFieldSubsystem
+		 : FlowFieldSubsystem = GetWorld()->GetSubsystem<UFlowFieldNavigationSubsystem>();
+}
@@ -0,0 +1,250 @@
+// Ricardo Santos, 2023
+
+#include "GameFramework/MXFPSBenchmarkGameMode.h"
+
+#include <EngineUtils.h>
+#include <GameFramework/Character.h>
+#include <GameFramework/CharacterMovementComponent.h>
+#include <Kismet/GameplayStatics.h>
+#include <Misc/App.h>
+#include <NavMesh/RecastNavMesh.h>
+#include <ProfilingDebugging/CsvProfiler.h>
+
+#include "Subsystem/SpawnPointSubsystem.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMXFPSBenchmark, Log, All);
+
+AMXFPSBenchmarkGameMode::AMXFPSBenchmarkGameMode(FObjectInitializer const& ObjectInitializer)
+	: Super{ ObjectInitializer }
+	, EnemyCountArray{ 4, 20, 100, 500 }
+{
+	// Unlike the base game mode, we drive the camera and count the frames ourselves
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = true;
+}
+
+void AMXFPSBenchmarkGameMode::InitGame(FString const& MapName, FString const& Options, FString& ErrorMessage)
+{
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	RandomSeed = UGameplayStatics::GetIntOption(Options, TEXT("Seed"), RandomSeed);
+
+	// Nothing here should depend on, or change, what the player has saved
+	bModifySaveGame = false;
+	bUseSaveGame = false;
+	bUseSoftReset = true;
+	bUseRandomPlayerSpawn = true;
+
+	if (EnemyCountArray.IsEmpty())
+	{
+		EnemyCountArray.Add(NumEnemies);
+	}
+	EnemyCountIndex = 0;
+	NumEnemies = EnemyCountArray[EnemyCountIndex];
+
+	if (!EnemyClassPtr)
+	{
+		EnemyClassPtr = DefaultEnemyClass.LoadSynchronous();
+	}
+
+	if (NavMeshPtr.IsNull())
+	{
+		TActorIterator<ARecastNavMesh> NavMeshIter{ GetWorld() };
+		NavMeshPtr = NavMeshIter ? *NavMeshIter : nullptr;
+	}
+
+	// Before anything asks for a spawn point, so the pool itself is the same on every run
+	GetGameInstance()->GetSubsystem<USpawnPointSubsystem>()->SetRandomSeed(RandomSeed);
+}
+
+void AMXFPSBenchmarkGameMode::BeginPlay()
+{
+	Super::BeginPlay();
+
+	OnGameOver.AddDynamic(this, &AMXFPSBenchmarkGameMode::HandleGameOver);
+}
+
+void AMXFPSBenchmarkGameMode::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (Phase == EBenchmarkPhase::Idle)
+	{
+		return;
+	}
+
+	if (Phase == EBenchmarkPhase::Finishing)
+	{
+		if (!CaptureWrittenEvent || CaptureWrittenEvent->IsComplete())
+		{
+			Phase = EBenchmarkPhase::Idle;
+			UE_LOG(LogMXFPSBenchmark, Display, TEXT("Benchmark finished"));
+
+			if (FApp::IsUnattended())
+			{
+				FPlatformMisc::RequestExit(false);
+			}
+		}
+		return;
+	}
+
+	MoveCamera(DeltaSeconds);
+	++NumPhaseFrames;
+
+	if (Phase == EBenchmarkPhase::WarmingUp)
+	{
+		if (NumPhaseFrames >= NumWarmupFrames)
+		{
+			BeginRecording();
+		}
+	}
+	else
+	{
+		double const FrameTime = FPlatformTime::Seconds();
+		TotalFrameTime += FrameTime - LastFrameTime;
+		MaxFrameTime = FMath::Max(MaxFrameTime, FrameTime - LastFrameTime);
+		LastFrameTime = FrameTime;
+
+		if (NumPhaseFrames >= NumRecordedFrames)
+		{
+			EndRecording();
+		}
+	}
+}
+
+void AMXFPSBenchmarkGameMode::OnNotifyGameReady_Implementation()
+{
+	Super::OnNotifyGameReady_Implementation();
+
+	// The same path for every enemy count, so the runs are comparable
+	if (CameraWaypointArray.IsEmpty())
+	{
+		BuildCameraPath();
+	}
+
+	CameraWaypointIndex = 0;
+	CameraLocation = CameraWaypointArray[0];
+	CameraYaw = 0.f;
+
+	Phase = EBenchmarkPhase::WarmingUp;
+	NumPhaseFrames = 0;
+
+	UE_LOG(LogMXFPSBenchmark, Display, TEXT("Benchmarking %d enemies, seed %d"), NumEnemies, RandomSeed);
+}
+
+void AMXFPSBenchmarkGameMode::BuildCameraPath()
+{
+	USpawnPointSubsystem const* SpawnPoints = GetGameInstance()->GetSubsystem<USpawnPointSubsystem>();
+
+	// Straight lines between the points, through walls if need be, we only care about what the camera sees
+	for (int32 WaypointIndex = 0; WaypointIndex < NumCameraWaypoints; ++WaypointIndex)
+	{
+		FVector Waypoint;
+		if (SpawnPoints->GetRandomSpawnPoint(Waypoint))
+		{
+			CameraWaypointArray.Add(Waypoint + FVector::UpVector * CameraHeight);
+		}
+	}
+
+	if (CameraWaypointArray.IsEmpty())
+	{
+		CameraWaypointArray.Add(LevelOrigin + FVector::UpVector * CameraHeight);
+	}
+}
+
+void AMXFPSBenchmarkGameMode::MoveCamera(float const DeltaSeconds)
+{
+	APlayerController* Player = GetWorld()->GetFirstPlayerController();
+	APawn* PlayerPawn = Player ? Player->GetPawn() : nullptr;
+	if (!PlayerPawn)
+	{
+		return;
+	}
+
+	// Bounded by the number of waypoints, in case some of them are the same point
+	int32 const NumWaypoints = CameraWaypointArray.Num();
+	double Distance = CameraSpeed * DeltaSeconds;
+	for (int32 Step = 0; Step < NumWaypoints && Distance > 0.0; ++Step)
+	{
+		FVector const& NextWaypoint = CameraWaypointArray[(CameraWaypointIndex + 1) % NumWaypoints];
+		double const DistanceToNext = FVector::Dist(CameraLocation, NextWaypoint);
+		if (DistanceToNext > Distance)
+		{
+			CameraLocation += (NextWaypoint - CameraLocation) / DistanceToNext * Distance;
+			break;
+		}
+
+		CameraLocation = NextWaypoint;
+		CameraWaypointIndex = (CameraWaypointIndex + 1) % NumWaypoints;
+		Distance -= DistanceToNext;
+	}
+
+	CameraYaw = FRotator::NormalizeAxis(CameraYaw + CameraYawRate * DeltaSeconds);
+
+	// The pawn is moved by us only, otherwise it would fall off the path
+	if (ACharacter* Character = Cast<ACharacter>(PlayerPawn))
+	{
+		UCharacterMovementComponent* MovementComponent = Character->GetCharacterMovement();
+		if (MovementComponent->MovementMode != MOVE_None)
+		{
+			MovementComponent->DisableMovement();
+		}
+	}
+
+	PlayerPawn->SetActorLocation(CameraLocation, false, nullptr, ETeleportType::TeleportPhysics);
+	Player->SetControlRotation(FRotator{ 0.f, CameraYaw, 0.f });
+}
+
+void AMXFPSBenchmarkGameMode::BeginRecording()
+{
+#if CSV_PROFILER
+	FString const MapName = UWorld::RemovePIEPrefix(GetWorld()->GetMapName());
+	FCsvProfiler::Get()->BeginCapture(-1, FString(), FString::Printf(TEXT("Benchmark_%s_%dEnemies.csv"), *MapName, NumEnemies));
+	CSV_METADATA(TEXT("BenchmarkEnemies"), *FString::FromInt(NumEnemies));
+	CSV_METADATA(TEXT("BenchmarkSeed"), *FString::FromInt(RandomSeed));
+#endif
+
+	Phase = EBenchmarkPhase::Recording;
+	NumPhaseFrames = 0;
+
+	LastFrameTime = FPlatformTime::Seconds();
+	TotalFrameTime = 0.0;
+	MaxFrameTime = 0.0;
+}
+
+void AMXFPSBenchmarkGameMode::EndRecording()
+{
+#if CSV_PROFILER
+	CaptureWrittenEvent = FGraphEvent::CreateGraphEvent();
+	FCsvProfiler::Get()->EndCapture(CaptureWrittenEvent);
+#endif
+
+	UE_LOG(LogMXFPSBenchmark, Display, TEXT("%d enemies: %d frames, %.2fms average, %.2fms worst"),
+		   NumEnemies, NumPhaseFrames, TotalFrameTime * 1000.0 / NumPhaseFrames, MaxFrameTime * 1000.0);
+
+	if (++EnemyCountIndex < EnemyCountArray.Num())
+	{
+		Phase = EBenchmarkPhase::Idle;
+		NumEnemies = EnemyCountArray[EnemyCountIndex];
+
+		// Each run starts from the same seed, regardless of the ones before it
+		GetGameInstance()->GetSubsystem<USpawnPointSubsystem>()->SetRandomSeed(RandomSeed);
+		RestartGame();
+	}
+	else
+	{
+		Phase = EBenchmarkPhase::Finishing;
+	}
+}
+
+void AMXFPSBenchmarkGameMode::HandleGameOver()
+{
+	// Getting caught is part of the workload, not the end of the run, unless it's over already
+	GetWorldTimerManager().SetTimerForNextTick(FTimerDelegate::CreateWeakLambda(this, [this]()
+	{
+		if (Phase == EBenchmarkPhase::WarmingUp || Phase == EBenchmarkPhase::Recording)
+		{
+			ExecuteGameStart();
+		}
+	}));
+}
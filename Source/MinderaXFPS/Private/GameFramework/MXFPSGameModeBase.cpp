@@ -11,16 +11,12 @@
 #include <Kismet/GameplayStatics.h>
 #include <NavMesh/RecastNavMesh.h>
 
+#include "Subsystem/EnemySpawnerSubsystem.h"
+#include "Subsystem/SaveGameSubsystem.h"
+#include "Subsystem/SpawnPointSubsystem.h"
+
 namespace
 {
-#if (UE_BUILD_DEBUG || UE_BUILD_DEVELOPMENT)
-	FName const SaveGameName = TEXT("MXFPSSaveGame_Debug");
-#else
-	FName const SaveGameName = TEXT("MXFPSSaveGame_0");
-#endif
-	
-	FName const UnknownSaveGameName = TEXT("SaveGame_Unknown");
-
 	FIntPoint BestWindowedResolution = FIntPoint::ZeroValue;
 	FIntPoint BestFullscreenResolution = FIntPoint(1280, 720);
 }
@@ -29,14 +25,15 @@ AMXFPSGameModeBase::AMXFPSGameModeBase(FObjectInitializer const& ObjectInitializ
 	: Super{ ObjectInitializer }
 	, GameOverResponsibleController{ nullptr }
 	, PlayerScore{ 0 }
-	, PlayerScoreOffset{ 0 }
+	, bHasNewHighscore{ false }
 	, PlayerSpawnLocation{ FVector::ZeroVector }
 	, bIsGameRunning{ false }
 	, bIsGamePaused{ false }
 	, bShouldRestartGame{ false }
 {
-	PrimaryActorTick.bCanEverTick = true;
-	PrimaryActorTick.bStartWithTickEnabled = true;
+	// Nothing to poll, the score is counted by a timer and everything else is event driven
+	PrimaryActorTick.bCanEverTick = false;
+	PrimaryActorTick.bStartWithTickEnabled = false;
 }
 
 void AMXFPSGameModeBase::BeginPlay()
@@ -46,6 +43,13 @@ void AMXFPSGameModeBase::BeginPlay()
 	CacheBestResolutionPerWindowMode();
 
 	UWorld* World = GetWorld();
+
+	// The only time we go through every actor, from now on pawns register themselves as they are spawned
+	ActorSpawnedHandle = World->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &AMXFPSGameModeBase::HandleActorSpawned));
+	for (TActorIterator<APawn> ActorIter{ World }; ActorIter; ++ActorIter)
+	{
+		RegisterPawn(*ActorIter);
+	}
 	
 	UClass* EnemyClass = EnemyClassPtr.Get();
 	if (!ensureMsgf(EnemyClass, TEXT("GameMode was improperly configured: missing EnemyClassPtr!")))
@@ -59,80 +63,43 @@ void AMXFPSGameModeBase::BeginPlay()
 		return;
 	}
 
+	PrepareSpawnPoints(NavMesh)->SetSafeArea(PlayerSpawnLocation, PlayerSafeRadius);
+
+	UEnemySpawnerSubsystem* EnemySpawner = World->GetSubsystem<UEnemySpawnerSubsystem>();
+	EnemySpawner->OnEnemyActivated.AddUObject(this, &AMXFPSGameModeBase::HandleEnemyActivated);
+	EnemySpawner->OnEnemyDeactivated.AddUObject(this, &AMXFPSGameModeBase::HandleEnemyDeactivated);
+	EnemySpawner->OnEnemiesReady.AddUObject(this, &AMXFPSGameModeBase::HandleEnemiesReady);
+
+	DisableAllInputAndMovement();
+
+	// The SaveGame was preloaded at boot, so this is usually immediate; otherwise we wait for it before spawning enemies
 	if (bModifySaveGame)
 	{
-		LoadSaveGame();
-		
-		if (bUseSaveGame)
-		{
-			NumEnemies = SaveGameData->NumEnemies;
-			EnemySpeed = SaveGameData->EnemySpeed;
-		}
-
-		ChangeWindowMode(SaveGameData->bIsFullscreen ? EWindowMode::Fullscreen : EWindowMode::Windowed); 
+		GetSaveGameSubsystem()->CallWhenSaveGameLoaded(
+			USaveGameSubsystem::FSaveGameLoadedEvent::FDelegate::CreateUObject(this, &AMXFPSGameModeBase::HandleSaveGameLoaded));
 	}
-
-	float SafeRadiusSquared = FMath::Square(PlayerSafeRadius);
-	for (int32 Index = 0; Index < NumEnemies; ++Index)
+	else
 	{
-		ACharacter* NewEnemy;
-		FVector SpawnLocation;
-		do
-		{
-			do
-			{
-				FNavLocation NavSpawnLocation;
-				NavMesh->GetRandomReachablePointInRadius(LevelOrigin, LevelRadius, NavSpawnLocation);
-			
-				SpawnLocation = NavSpawnLocation.Location;
-			}
-			while (FVector::DistSquared(SpawnLocation, PlayerSpawnLocation) < SafeRadiusSquared);
-
-			NewEnemy = World->SpawnActor<ACharacter>(EnemyClass, SpawnLocation, FRotator::ZeroRotator);
-		}
-		while (!NewEnemy);
-
-		UCharacterMovementComponent* MovementComponent = NewEnemy->GetCharacterMovement();
-		MovementComponent->MaxWalkSpeed = EnemySpeed * 100.f;
+		SpawnEnemies();
 	}
-
-	DisableAllInputAndMovement();
-
-	GetWorldTimerManager().SetTimerForNextTick([this]{ OnNotifyGameReady(); });
 }
 
 void AMXFPSGameModeBase::EndPlay(EEndPlayReason::Type const EndPlayReason)
 {
 	Super::EndPlay(EndPlayReason);
 
-	if (bModifySaveGame)
+	GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+	RegisteredPawnArray.Reset();
+	RegisteredPawnIndexMap.Reset();
+
+	if (bModifySaveGame && SaveGameData)
 	{
-		if (bUseSaveGame)
-		{
-			// If the exit was not requested by the player, check and update highscore
-			if (HasNewHighscore() && GetGameOverResponsibleController() != GetWorld()->GetFirstPlayerController())
-			{
-				SaveGameData->HighScore = GetPlayerScore();
-			}
-		}
+		UpdateHighscore();
 		
 		StoreSaveGame();
 	}
 }
 
-void AMXFPSGameModeBase::Tick(float DeltaSeconds)
-{
-	Super::Tick(DeltaSeconds);
-
-	if (bIsGameRunning)
-	{
-		auto GameCurrentTime = FDateTime::UtcNow();
-		FTimespan ElapsedTime = GameCurrentTime - GameRunningTime;
-	
-		PlayerScore = FMath::RoundToInt32(ElapsedTime.GetTotalSeconds());
-	}
-}
-
 AActor* AMXFPSGameModeBase::ChoosePlayerStart_Implementation(AController* Player)
 {
 	AActor* PlayerStart;
@@ -141,13 +108,27 @@ AActor* AMXFPSGameModeBase::ChoosePlayerStart_Implementation(AController* Player
 		ARecastNavMesh* NavMesh = NavMeshPtr.LoadSynchronous();
 		checkf(NavMesh, TEXT("GameMode was improperly configured: missing NavMeshPtr!"));
 		
-		FNavLocation NavLocation;
-		NavMesh->GetRandomReachablePointInRadius(LevelOrigin, LevelRadius, NavLocation);
+		USpawnPointSubsystem* SpawnPoints = PrepareSpawnPoints(NavMesh);
+		FVector SpawnLocation = LevelOrigin;
+		SpawnPoints->GetRandomSpawnPoint(SpawnLocation);
+		FRotator SpawnRotation = FRotator{0.f, SpawnPoints->GetRandomYaw(), 0.f};
 
-		FVector SpawnLocation = NavLocation.Location;
-		FRotator SpawnRotation = FRotator{0.f, FMath::RandRange(0.f, 360.f), 0.f};
+		// Every soft reset chooses a start again, the same one is moved around instead of spawning another
+		if (RandomPlayerStart)
+		{
+			RandomPlayerStart->SetActorLocationAndRotation(SpawnLocation, SpawnRotation);
+		}
+		else
+		{
+			// Player starts are static, as they're usually placed in the level
+			RandomPlayerStart = GetWorld()->SpawnActor<APlayerStart>(SpawnLocation, SpawnRotation);
+			if (RandomPlayerStart)
+			{
+				RandomPlayerStart->GetRootComponent()->SetMobility(EComponentMobility::Movable);
+			}
+		}
 
-		PlayerStart = GetWorld()->SpawnActor<APlayerStart>(SpawnLocation, SpawnRotation);
+		PlayerStart = RandomPlayerStart;
 	}
 	else
 	{
@@ -172,11 +153,14 @@ void AMXFPSGameModeBase::ExecuteGameStart()
 	if (ensure(!bIsGameRunning))
 	{
 		bIsGameRunning = true;
-		GameRunningTime = FDateTime::UtcNow();
+
+		// The score is the running time rounded to the nearest second, so the first one is half a second in
+		GetWorldTimerManager().SetTimer(ScoreTimerHandle, this, &AMXFPSGameModeBase::HandleScoreTimer, 1.f, true, 0.5f);
 
 		EnableAllInputAndMovement();
 			
 		OnGameStart.Broadcast();
+		BroadcastGameRunningChanged();
 	}
 }
 
@@ -190,9 +174,12 @@ void AMXFPSGameModeBase::ExecuteGameOver(AController* ResponsibleController, boo
 		bShouldRestartGame = bShouldRestart;
 		GameOverResponsibleController = ResponsibleController;
 
+		GetWorldTimerManager().ClearTimer(ScoreTimerHandle);
+
 		DisableAllInputAndMovement();
 
 		OnGameOver.Broadcast();
+		BroadcastGameRunningChanged();
 	}
 }
 
@@ -201,11 +188,18 @@ void AMXFPSGameModeBase::ResumeGame()
 	if (ensure(bIsGamePaused))
 	{
 		bIsGamePaused = false;
-		GameRunningTime = FDateTime::UtcNow();
+		GetWorldTimerManager().UnPauseTimer(ScoreTimerHandle);
+
+		// Settings might have been changed while paused
+		if (bModifySaveGame && SaveGameData)
+		{
+			StoreSaveGame();
+		}
 
 		EnableAllInputAndMovement();
 
 		OnGameResumed.Broadcast();
+		BroadcastGameRunningChanged();
 	}
 }
 
@@ -214,20 +208,23 @@ void AMXFPSGameModeBase::PauseGame()
 	if (ensure(!bIsGamePaused))
 	{
 		bIsGamePaused = true;
-		PlayerScoreOffset += PlayerScore;
-		PlayerScore = 0;
+
+		// The world keeps ticking while paused, and so would the timer, which keeps what's left of the current second
+		GetWorldTimerManager().PauseTimer(ScoreTimerHandle);
 		
 		DisableAllInputAndMovement();
 
 		OnGamePaused.Broadcast();
+		BroadcastGameRunningChanged();
 	}
 }
 
 void AMXFPSGameModeBase::ResetHighscore()
 {
-	if (bModifySaveGame)
+	if (bModifySaveGame && SaveGameData)
 	{
 		SaveGameData->HighScore = -1;
+		UpdateHasNewHighscore();
 	}
 }
 
@@ -275,12 +272,12 @@ bool AMXFPSGameModeBase::HasNewHighscore() const
 
 int32 AMXFPSGameModeBase::GetPlayerScore() const
 {
-	return PlayerScore + PlayerScoreOffset;
+	return PlayerScore;
 }
 
 int32 AMXFPSGameModeBase::GetPlayerHighscore() const
 {
-	return ensure(bModifySaveGame) ? SaveGameData->HighScore : -1;
+	return ensure(bModifySaveGame) && SaveGameData ? SaveGameData->HighScore : -1;
 }
 
 AController* AMXFPSGameModeBase::GetGameOverResponsibleController() const
@@ -293,28 +290,91 @@ UMXFPSSaveGameData* AMXFPSGameModeBase::GetSaveGameData() const
 	return SaveGameData;
 }
 
+TArray<FMXFPSRegisteredPawn> const& AMXFPSGameModeBase::GetRegisteredPawns() const
+{
+	return RegisteredPawnArray;
+}
+
 void AMXFPSGameModeBase::RestartGame()
 {
-	GetWorld()->GetFirstPlayerController()->RestartLevel();
+	if (bUseSoftReset)
+	{
+		SoftResetGame();
+	}
+	else
+	{
+		GetWorld()->GetFirstPlayerController()->RestartLevel();
+	}
 }
 
-// ReSharper disable once CppMemberFunctionMayBeConst
-void AMXFPSGameModeBase::EnableAllInputAndMovement() 
+void AMXFPSGameModeBase::SoftResetGame()
 {
 	UWorld* World = GetWorld();
-	
-	for (TActorIterator<APawn> ActorIter{ World }; ActorIter; ++ActorIter)
+
+	UClass* EnemyClass = EnemyClassPtr.Get();
+	ARecastNavMesh* NavMesh = NavMeshPtr.Get();
+	if (!EnemyClass || !NavMesh)
 	{
-		APawn* Pawn = *ActorIter;
-		Pawn->EnableInput(nullptr);
-		
-		if (ACharacter* Character = Cast<ACharacter>(Pawn))
+		World->GetFirstPlayerController()->RestartLevel();
+		return;
+	}
+
+	// What EndPlay would've done, had the level been reloaded
+	if (bModifySaveGame && SaveGameData)
+	{
+		UpdateHighscore();
+		StoreSaveGame();
+
+		if (bUseSaveGame)
 		{
-			AController* Controller = Pawn->GetController();
-			bool bIsAIControlled = Controller ? Controller->IsA<AAIController>() : false;
+			NumEnemies = SaveGameData->NumEnemies;
+			EnemySpeed = SaveGameData->EnemySpeed;
+		}
+	}
+
+	GetWorldTimerManager().ClearTimer(ScoreTimerHandle);
+	SetPlayerScore(0);
+	GameOverResponsibleController = nullptr;
+	bIsGameRunning = false;
+	bIsGamePaused = false;
+	bShouldRestartGame = false;
+
+	for (auto PlayerIter = World->GetPlayerControllerIterator(); PlayerIter; ++PlayerIter)
+	{
+		APlayerController* PlayerController = PlayerIter->Get();
+		APawn* PlayerPawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+		if (!PlayerPawn)
+		{
+			continue;
+		}
+
+		if (AActor* PlayerStart = ChoosePlayerStart(PlayerController))
+		{
+			PlayerPawn->SetActorLocationAndRotation(PlayerStart->GetActorLocation(), PlayerStart->GetActorRotation(),
+													false, nullptr, ETeleportType::ResetPhysics);
+			PlayerController->SetControlRotation(PlayerStart->GetActorRotation());
+		}
+	}
+
+	PrepareSpawnPoints(NavMesh)->SetSafeArea(PlayerSpawnLocation, PlayerSafeRadius);
+
+	UEnemySpawnerSubsystem* EnemySpawner = World->GetSubsystem<UEnemySpawnerSubsystem>();
+	EnemySpawner->SetNumActiveEnemies(EnemyClass, NumEnemies);
+	EnemySpawner->ResetActiveEnemies();
+
+	DisableAllInputAndMovement();
+}
 
-			UCharacterMovementComponent* MovementComponent = Character->GetCharacterMovement();
-			MovementComponent->SetMovementMode(bIsAIControlled ? MOVE_NavWalking : MOVE_Walking);
+// ReSharper disable once CppMemberFunctionMayBeConst
+void AMXFPSGameModeBase::EnableAllInputAndMovement() 
+{
+	for (FMXFPSRegisteredPawn const& RegisteredPawn : RegisteredPawnArray)
+	{
+		RegisteredPawn.Pawn->EnableInput(nullptr);
+
+		if (RegisteredPawn.MovementComponent)
+		{
+			RegisteredPawn.MovementComponent->SetMovementMode(RegisteredPawn.bIsAIControlled ? MOVE_NavWalking : MOVE_Walking);
 		}
 	}
 }
@@ -322,43 +382,201 @@ void AMXFPSGameModeBase::EnableAllInputAndMovement()
 // ReSharper disable once CppMemberFunctionMayBeConst
 void AMXFPSGameModeBase::DisableAllInputAndMovement()
 {
-	UWorld* World = GetWorld();
-	
-	for (TActorIterator<APawn> ActorIter{ World }; ActorIter; ++ActorIter)
+	for (FMXFPSRegisteredPawn const& RegisteredPawn : RegisteredPawnArray)
 	{
-		APawn* Pawn = *ActorIter;
-		Pawn->DisableInput(nullptr);
-		
-		if (ACharacter* Character = Cast<ACharacter>(Pawn))
+		RegisteredPawn.Pawn->DisableInput(nullptr);
+
+		if (RegisteredPawn.MovementComponent)
 		{
-			UCharacterMovementComponent* MovementComponent = Character->GetCharacterMovement();
-			MovementComponent->SetMovementMode(MOVE_None);
+			RegisteredPawn.MovementComponent->SetMovementMode(MOVE_None);
 		}
 	}
 }
 
-void AMXFPSGameModeBase::LoadSaveGame()
+void AMXFPSGameModeBase::BroadcastGameRunningChanged()
+{
+	OnGameRunningChanged.Broadcast(IsGameRunning());
+	OnGameRunningChangedNative.Broadcast(IsGameRunning());
+}
+
+void AMXFPSGameModeBase::HandleScoreTimer()
+{
+	SetPlayerScore(PlayerScore + 1);
+}
+
+void AMXFPSGameModeBase::SetPlayerScore(int32 const NewPlayerScore)
+{
+	if (NewPlayerScore == PlayerScore)
+	{
+		return;
+	}
+
+	PlayerScore = NewPlayerScore;
+	OnScoreChanged.Broadcast(PlayerScore);
+
+	UpdateHasNewHighscore();
+}
+
+void AMXFPSGameModeBase::UpdateHasNewHighscore()
+{
+	// There's no highscore to beat without the SaveGame
+	bool const bHasNewHighscoreNow = bModifySaveGame && SaveGameData && HasNewHighscore();
+	if (bHasNewHighscoreNow != bHasNewHighscore)
+	{
+		bHasNewHighscore = bHasNewHighscoreNow;
+		OnNewHighscoreChanged.Broadcast(bHasNewHighscore);
+	}
+}
+
+void AMXFPSGameModeBase::SpawnEnemies()
+{
+	// Enemies are spawned over the next frames, the game is ready once they all are
+	GetWorld()->GetSubsystem<UEnemySpawnerSubsystem>()->SetNumActiveEnemies(EnemyClassPtr.Get(), NumEnemies);
+}
+
+void AMXFPSGameModeBase::HandleEnemyActivated(APawn* Enemy)
+{
+	// It might have been pooled, or gotten its controller after being spawned
+	RegisterPawn(Enemy);
+
+	if (ACharacter* Character = Cast<ACharacter>(Enemy))
+	{
+		UCharacterMovementComponent* MovementComponent = Character->GetCharacterMovement();
+		MovementComponent->MaxWalkSpeed = EnemySpeed * 100.f;
+		MovementComponent->SetMovementMode(bIsGameRunning ? MOVE_NavWalking : MOVE_None);
+	}
+
+	if (bIsGameRunning)
+	{
+		Enemy->EnableInput(nullptr);
+	}
+	else
+	{
+		Enemy->DisableInput(nullptr);
+	}
+}
+
+void AMXFPSGameModeBase::HandleEnemyDeactivated(APawn* Enemy)
+{
+	UnregisterPawn(Enemy);
+}
+
+void AMXFPSGameModeBase::HandleEnemiesReady()
+{
+	OnNotifyGameReady();
+}
+
+void AMXFPSGameModeBase::RegisterPawn(APawn* Pawn)
+{
+	if (!IsValid(Pawn))
+	{
+		return;
+	}
+
+	AController const* Controller = Pawn->GetController();
+	ACharacter const* Character = Cast<ACharacter>(Pawn);
+
+	FMXFPSRegisteredPawn RegisteredPawn;
+	RegisteredPawn.Pawn = Pawn;
+	RegisteredPawn.MovementComponent = Character ? Character->GetCharacterMovement() : nullptr;
+	RegisteredPawn.bIsAIControlled = Controller ? Controller->IsA<AAIController>() : false;
+
+	if (int32 const* IndexPtr = RegisteredPawnIndexMap.Find(Pawn))
+	{
+		RegisteredPawnArray[*IndexPtr] = RegisteredPawn;
+		return;
+	}
+
+	RegisteredPawnIndexMap.Add(Pawn, RegisteredPawnArray.Add(RegisteredPawn));
+	Pawn->OnEndPlay.AddUniqueDynamic(this, &AMXFPSGameModeBase::HandlePawnEndPlay);
+	Pawn->ReceiveControllerChangedDelegate.AddUniqueDynamic(this, &AMXFPSGameModeBase::HandlePawnControllerChanged);
+}
+
+void AMXFPSGameModeBase::UnregisterPawn(APawn* Pawn)
+{
+	int32 Index;
+	if (!RegisteredPawnIndexMap.RemoveAndCopyValue(Pawn, Index))
+	{
+		return;
+	}
+
+	Pawn->OnEndPlay.RemoveDynamic(this, &AMXFPSGameModeBase::HandlePawnEndPlay);
+	Pawn->ReceiveControllerChangedDelegate.RemoveDynamic(this, &AMXFPSGameModeBase::HandlePawnControllerChanged);
+
+	// The last pawn takes the place of the one removed
+	RegisteredPawnArray.RemoveAtSwap(Index, 1, false);
+	if (RegisteredPawnArray.IsValidIndex(Index))
+	{
+		RegisteredPawnIndexMap[RegisteredPawnArray[Index].Pawn] = Index;
+	}
+}
+
+void AMXFPSGameModeBase::HandleActorSpawned(AActor* Actor)
 {
-	if (auto SaveGame = UGameplayStatics::LoadGameFromSlot(SaveGameName.ToString(), 0))
+	if (APawn* Pawn = Cast<APawn>(Actor))
 	{
-		SaveGameData = Cast<UMXFPSSaveGameData>(SaveGame);
+		RegisterPawn(Pawn);
+	}
+}
+
+void AMXFPSGameModeBase::HandlePawnEndPlay(AActor* Actor, EEndPlayReason::Type EndPlayReason)
+{
+	UnregisterPawn(CastChecked<APawn>(Actor));
+}
 
-		if (!ensureMsgf(SaveGameData, TEXT("SaveGame exists but has unknown class type!")))
+void AMXFPSGameModeBase::HandlePawnControllerChanged(APawn* Pawn, AController* OldController, AController* NewController)
+{
+	// Pawns can be possessed after they're spawned, or by someone else later on
+	if (int32 const* IndexPtr = RegisteredPawnIndexMap.Find(Pawn))
+	{
+		RegisteredPawnArray[*IndexPtr].bIsAIControlled = NewController ? NewController->IsA<AAIController>() : false;
+	}
+}
+
+void AMXFPSGameModeBase::UpdateHighscore()
+{
+	if (bUseSaveGame)
+	{
+		// If the exit was not requested by the player, check and update highscore
+		if (HasNewHighscore() && GetGameOverResponsibleController() != GetWorld()->GetFirstPlayerController())
 		{
-			UGameplayStatics::SaveGameToSlot(SaveGame, UnknownSaveGameName.ToString(), 0);
+			SaveGameData->HighScore = GetPlayerScore();
 		}
 	}
+}
+
+USpawnPointSubsystem* AMXFPSGameModeBase::PrepareSpawnPoints(ARecastNavMesh const* NavMesh) const
+{
+	USpawnPointSubsystem* SpawnPoints = GetGameInstance()->GetSubsystem<USpawnPointSubsystem>();
+	SpawnPoints->BuildSpawnPointPool(GetWorld(), NavMesh, LevelOrigin, LevelRadius, SpawnPointSpacing);
+	return SpawnPoints;
+}
+
+void AMXFPSGameModeBase::HandleSaveGameLoaded(UMXFPSSaveGameData* LoadedSaveGameData)
+{
+	SaveGameData = LoadedSaveGameData;
 
-	if (!SaveGameData)
+	if (bUseSaveGame)
 	{
-		SaveGameData = NewObject<UMXFPSSaveGameData>(this, SaveGameName);
+		NumEnemies = SaveGameData->NumEnemies;
+		EnemySpeed = SaveGameData->EnemySpeed;
 	}
+
+	ChangeWindowMode(SaveGameData->bIsFullscreen ? EWindowMode::Fullscreen : EWindowMode::Windowed);
+
+	SpawnEnemies();
 }
 
 // ReSharper disable once CppMemberFunctionMayBeConst
 void AMXFPSGameModeBase::StoreSaveGame()
 {
-	UGameplayStatics::SaveGameToSlot(SaveGameData, SaveGameName.ToString(), 0);
+	// Coalesced with any other store still in flight, e.g., when pausing and quitting right after
+	GetSaveGameSubsystem()->RequestStore();
+}
+
+USaveGameSubsystem* AMXFPSGameModeBase::GetSaveGameSubsystem() const
+{
+	return GetGameInstance()->GetSubsystem<USaveGameSubsystem>();
 }
 
 void AMXFPSGameModeBase::CacheBestResolutionPerWindowMode()
@@ -0,0 +1,192 @@
+// Ricardo Santos, 2023
+
+#include "GameFramework/QulockReplicationInfo.h"
+
+#include <GameFramework/PawnMovementComponent.h>
+#include <Net/UnrealNetwork.h>
+
+#include "Subsystem/QulockReplicationSubsystem.h"
+
+namespace
+{
+	bool bUseDormancyWhileFrozen = true;
+	FAutoConsoleVariableRef CVarUseDormancyWhileFrozen(
+		TEXT("Qulock.Net.DormantWhileFrozen"),
+		bUseDormancyWhileFrozen,
+		TEXT("Whether frozen Qulock targets go dormant on the server, so they aren't even considered for replication until they unfreeze."));
+
+	bool IsSlotBitSet(TArray<uint8> const& SlotBits, int32 const Slot)
+	{
+		int32 const ByteIndex = Slot / 8;
+		return SlotBits.IsValidIndex(ByteIndex) && (SlotBits[ByteIndex] & (1 << (Slot % 8))) != 0;
+	}
+
+	void SetSlotBit(TArray<uint8>& SlotBits, int32 const Slot, bool const bValue)
+	{
+		uint8& Byte = SlotBits[Slot / 8];
+		uint8 const Mask = 1 << (Slot % 8);
+		Byte = bValue ? Byte | Mask : Byte & ~Mask;
+	}
+}
+
+AQulockReplicationInfo::AQulockReplicationInfo(FObjectInitializer const& ObjectInitializer)
+	: Super{ ObjectInitializer }
+{
+	bReplicates = true;
+	bAlwaysRelevant = true;
+
+	// Nothing changes while nobody freezes or unfreezes, and when someone does, every client should know as soon as possible
+	NetPriority = 3.f;
+}
+
+void AQulockReplicationInfo::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AQulockReplicationInfo, TargetSlotArray);
+	DOREPLIFETIME(AQulockReplicationInfo, FrozenSlotBits);
+}
+
+void AQulockReplicationInfo::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	if (UQulockReplicationSubsystem* ReplicationSubsystem = GetWorld()->GetSubsystem<UQulockReplicationSubsystem>())
+	{
+		ReplicationSubsystem->SetReplicationInfo(this);
+	}
+}
+
+void AQulockReplicationInfo::EndPlay(EEndPlayReason::Type const EndPlayReason)
+{
+	UQulockReplicationSubsystem* ReplicationSubsystem = GetWorld()->GetSubsystem<UQulockReplicationSubsystem>();
+	if (ReplicationSubsystem && ReplicationSubsystem->GetReplicationInfo() == this)
+	{
+		ReplicationSubsystem->SetReplicationInfo(nullptr);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AQulockReplicationInfo::SetTargetFrozen(APawn* Target, bool const bIsFrozen)
+{
+	if (!Target || !HasAuthority())
+	{
+		return;
+	}
+
+	int32 const* SlotPtr = TargetSlotMap.Find(Target);
+	if (SlotPtr && IsSlotBitSet(FrozenSlotBits, *SlotPtr) == bIsFrozen)
+	{
+		return;
+	}
+
+	int32 Slot;
+	if (SlotPtr)
+	{
+		Slot = *SlotPtr;
+	}
+	else
+	{
+		Slot = FreeSlotArray.Num() > 0 ? FreeSlotArray.Pop(false) : TargetSlotArray.Add(nullptr);
+		TargetSlotArray[Slot] = Target;
+		TargetSlotMap.Add(Target, Slot);
+		FrozenSlotBits.SetNumZeroed(FMath::DivideAndRoundUp(TargetSlotArray.Num(), 8));
+	}
+
+	SetSlotBit(FrozenSlotBits, Slot, bIsFrozen);
+
+	// Dormancy only kicks in once whatever changed before it is replicated, so clients still get where the target froze
+	if (bUseDormancyWhileFrozen && Target->GetIsReplicated())
+	{
+		Target->SetNetDormancy(bIsFrozen ? DORM_DormantAll : DORM_Awake);
+	}
+}
+
+void AQulockReplicationInfo::RemoveTarget(APawn* Target)
+{
+	int32 Slot;
+	if (!Target || !HasAuthority() || !TargetSlotMap.RemoveAndCopyValue(Target, Slot))
+	{
+		return;
+	}
+
+	// Whoever has the target next expects it as we found it
+	if (IsSlotBitSet(FrozenSlotBits, Slot) && Target->GetIsReplicated() && Target->NetDormancy == DORM_DormantAll)
+	{
+		Target->SetNetDormancy(DORM_Awake);
+	}
+
+	SetSlotBit(FrozenSlotBits, Slot, false);
+	TargetSlotArray[Slot] = nullptr;
+	FreeSlotArray.Add(Slot);
+}
+
+void AQulockReplicationInfo::NotifyTargetMoved(APawn* Target)
+{
+	int32 const* SlotPtr = HasAuthority() ? TargetSlotMap.Find(Target) : nullptr;
+	if (SlotPtr && IsSlotBitSet(FrozenSlotBits, *SlotPtr) && Target->NetDormancy == DORM_DormantAll)
+	{
+		Target->FlushNetDormancy();
+	}
+}
+
+bool AQulockReplicationInfo::IsTargetFrozen(APawn const* Target) const
+{
+	int32 const* SlotPtr = TargetSlotMap.Find(Target);
+	return SlotPtr && IsSlotBitSet(FrozenSlotBits, *SlotPtr);
+}
+
+void AQulockReplicationInfo::OnRep_FrozenTargets()
+{
+	// Both arrays usually arrive together, but either might be behind, or a target might not be mapped yet,
+	// in which case this is called again once it is; either way, only what changed since last time is handled.
+	for (int32 Slot = 0; Slot < TargetSlotArray.Num(); ++Slot)
+	{
+		APawn* Target = TargetSlotArray[Slot];
+		APawn* ReceivedTarget = ReceivedTargetSlotArray.IsValidIndex(Slot) ? ReceivedTargetSlotArray[Slot].Get() : nullptr;
+
+		bool const bIsFrozen = Target && IsSlotBitSet(FrozenSlotBits, Slot);
+		bool const bWasFrozen = ReceivedTarget && IsSlotBitSet(ReceivedFrozenSlotBits, Slot);
+
+		if (ReceivedTarget != Target)
+		{
+			if (ReceivedTarget)
+			{
+				TargetSlotMap.Remove(ReceivedTarget);
+				if (bWasFrozen)
+				{
+					HandleTargetFrozenChanged(ReceivedTarget, false);
+				}
+			}
+
+			if (Target)
+			{
+				TargetSlotMap.Add(Target, Slot);
+				if (bIsFrozen)
+				{
+					HandleTargetFrozenChanged(Target, true);
+				}
+			}
+		}
+		else if (Target && bIsFrozen != bWasFrozen)
+		{
+			HandleTargetFrozenChanged(Target, bIsFrozen);
+		}
+	}
+
+	ReceivedTargetSlotArray = TArray<TWeakObjectPtr<APawn>>(TargetSlotArray);
+	ReceivedFrozenSlotBits = FrozenSlotBits;
+}
+
+void AQulockReplicationInfo::HandleTargetFrozenChanged(APawn* Target, bool const bIsFrozen)
+{
+	// Simulated proxies stop simulating while frozen, like their authority does,
+	// otherwise they would keep extrapolating the last velocity they got, which won't be replicated again until they unfreeze.
+	if (UPawnMovementComponent* MovementComponent = Target->GetMovementComponent())
+	{
+		MovementComponent->SetComponentTickEnabled(!bIsFrozen);
+	}
+
+	OnTargetFrozenChanged.Broadcast(Target, bIsFrozen);
+}
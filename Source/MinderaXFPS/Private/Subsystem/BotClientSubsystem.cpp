@@ -0,0 +1,73 @@
+// Ricardo Santos, 2023
+
+#include "Subsystem/BotClientSubsystem.h"
+
+#include <GameFramework/Pawn.h>
+#include <GameFramework/PlayerController.h>
+
+namespace
+{
+	constexpr float MaxTurnRate = 90.f;
+	constexpr float MinTurnTime = 1.f;
+	constexpr float MaxTurnTime = 4.f;
+}
+
+bool UBotClientSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return Super::ShouldCreateSubsystem(Outer)
+		&& FParse::Param(FCommandLine::Get(), TEXT("BotClient"));
+}
+
+void UBotClientSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	// Seeded with -BotSeed=, so a given bot can be made to do the same thing again
+	int32 Seed;
+	if (FParse::Value(FCommandLine::Get(), TEXT("BotSeed="), Seed))
+	{
+		RandomStream.Initialize(Seed);
+	}
+	else
+	{
+		RandomStream.GenerateNewSeed();
+	}
+}
+
+void UBotClientSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+	if (!Pawn || !PlayerController->IsLocalController())
+	{
+		return;
+	}
+
+	TurnTimeLeft -= DeltaTime;
+	if (TurnTimeLeft <= 0.f)
+	{
+		TurnRate = RandomStream.FRandRange(-MaxTurnRate, MaxTurnRate);
+		TurnTimeLeft = RandomStream.FRandRange(MinTurnTime, MaxTurnTime);
+	}
+
+	// Both are sent to the server along with our moves, as they would be for a real player
+	FRotator ControlRotation = PlayerController->GetControlRotation();
+	ControlRotation.Yaw = FRotator::NormalizeAxis(ControlRotation.Yaw + TurnRate * DeltaTime);
+	ControlRotation.Pitch = 0.f;
+	PlayerController->SetControlRotation(ControlRotation);
+
+	Pawn->AddMovementInput(ControlRotation.Vector());
+}
+
+TStatId UBotClientSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UBotClientSubsystem, STATGROUP_Tickables);
+}
+
+bool UBotClientSubsystem::DoesSupportWorldType(EWorldType::Type const WorldType) const
+{
+	return WorldType == EWorldType::Game
+		|| WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,38 @@
+// Ricardo Santos, 2023
+
+#pragma once
+
+#include <CoreMinimal.h>
+#include <Subsystems/WorldSubsystem.h>
+
+#include "BotClientSubsystem.generated.h"
+
+// Plays the first local player on its own, so that a dedicated server can be loaded with as many connections as needed
+// from a single machine, e.g., a headless server and a few headless bots:
+//   MinderaXFPSServer LBP_FixedLayoutMap -port=7777 -log
+//   MinderaXFPS 127.0.0.1:7777 -BotClient -nullrhi -nosound -unattended -log
+// Bots keep walking and turning at random, so the stalkers keep going in and out of their views; only created with -BotClient.
+UCLASS()
+class UBotClientSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type const WorldType) const override;
+
+private:
+	FRandomStream RandomStream;
+
+	// In degrees/sec, picked again whenever the time left runs out
+	float TurnRate = 0.f;
+	float TurnTimeLeft = 0.f;
+
+};
@@ -0,0 +1,287 @@
+// Ricardo Santos, 2023
+
+#include "Subsystem/EnemySpawnerSubsystem.h"
+
+#include <AIController.h>
+#include <BrainComponent.h>
+#include <GameFramework/Character.h>
+#include <GameFramework/CharacterMovementComponent.h>
+
+#include "Components/QulockComponent.h"
+#include "Subsystem/SpawnPointSubsystem.h"
+
+DECLARE_STATS_GROUP(TEXT("Enemy Spawner"), STATGROUP_EnemySpawner, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("Activate Enemies"), STAT_ActivateEnemies, STATGROUP_EnemySpawner);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Spawned Enemies"), STAT_SpawnedEnemies, STATGROUP_EnemySpawner);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Reused Enemies"), STAT_ReusedEnemies, STATGROUP_EnemySpawner);
+
+namespace
+{
+	float SpawnBudgetMs = 2.f;
+	FAutoConsoleVariableRef CVarSpawnBudgetMs(
+		TEXT("Enemies.SpawnBudgetMs"),
+		SpawnBudgetMs,
+		TEXT("How long spawning and activating enemies may take per frame, in milliseconds; ")
+		TEXT("at least one enemy is activated per frame regardless."));
+
+	FName const PooledReason = TEXT("Pooled");
+}
+
+void UEnemySpawnerSubsystem::Deinitialize()
+{
+	ActiveEnemyArray.Reset();
+	PooledEnemyArray.Reset();
+	NumRequestedEnemies = 0;
+	bIsSpawning = false;
+
+	Super::Deinitialize();
+}
+
+void UEnemySpawnerSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!bIsSpawning)
+	{
+		return;
+	}
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_ActivateEnemies);
+
+		double const EndTime = FPlatformTime::Seconds() + SpawnBudgetMs * 0.001;
+		do
+		{
+			if (ActiveEnemyArray.Num() >= NumRequestedEnemies)
+			{
+				break;
+			}
+
+			// Reusing an enemy is much cheaper than spawning one, so the pool goes first
+			APawn* Enemy = nullptr;
+			while (!Enemy && !PooledEnemyArray.IsEmpty())
+			{
+				Enemy = PooledEnemyArray.Pop(false);
+				Enemy = IsValid(Enemy) ? Enemy : nullptr;
+			}
+
+			if (Enemy)
+			{
+				if (ActivateEnemy(Enemy))
+				{
+					INC_DWORD_STAT(STAT_ReusedEnemies);
+				}
+				else
+				{
+					// Out of spawn points, spawning a new one won't work either
+					PooledEnemyArray.Add(Enemy);
+					Enemy = nullptr;
+				}
+			}
+
+			if (!Enemy)
+			{
+				Enemy = SpawnEnemy();
+				if (!ensureMsgf(Enemy, TEXT("Couldn't find a spawn point for enemy %d out of %d!"), ActiveEnemyArray.Num() + 1, NumRequestedEnemies))
+				{
+					NumRequestedEnemies = ActiveEnemyArray.Num();
+					break;
+				}
+
+				INC_DWORD_STAT(STAT_SpawnedEnemies);
+			}
+
+			ActiveEnemyArray.Add(Enemy);
+			OnEnemyActivated.Broadcast(Enemy);
+		}
+		while (FPlatformTime::Seconds() < EndTime);
+	}
+
+	if (ActiveEnemyArray.Num() >= NumRequestedEnemies)
+	{
+		bIsSpawning = false;
+
+		OnEnemiesReady.Broadcast();
+	}
+}
+
+TStatId UEnemySpawnerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UEnemySpawnerSubsystem, STATGROUP_Tickables);
+}
+
+void UEnemySpawnerSubsystem::SetNumActiveEnemies(TSubclassOf<APawn> NewEnemyClass, int32 NumEnemies)
+{
+	// Enemies of another class can't be reused
+	if (EnemyClass != NewEnemyClass)
+	{
+		for (APawn* Enemy : PooledEnemyArray)
+		{
+			if (IsValid(Enemy))
+			{
+				Enemy->Destroy();
+			}
+		}
+		PooledEnemyArray.Reset();
+
+		while (!ActiveEnemyArray.IsEmpty())
+		{
+			if (APawn* Enemy = ActiveEnemyArray.Pop(false); IsValid(Enemy))
+			{
+				Enemy->Destroy();
+			}
+		}
+
+		EnemyClass = NewEnemyClass;
+	}
+
+	NumRequestedEnemies = FMath::Max(NumEnemies, 0);
+
+	while (ActiveEnemyArray.Num() > NumRequestedEnemies)
+	{
+		APawn* Enemy = ActiveEnemyArray.Pop(false);
+		if (IsValid(Enemy))
+		{
+			DeactivateEnemy(Enemy);
+			PooledEnemyArray.Add(Enemy);
+
+			OnEnemyDeactivated.Broadcast(Enemy);
+		}
+	}
+
+	// Even if nothing needs to be spawned, listeners are told that we're ready on the next tick, as they'd expect
+	bIsSpawning = true;
+}
+
+void UEnemySpawnerSubsystem::ResetActiveEnemies()
+{
+	USpawnPointSubsystem* SpawnPoints = GetSpawnPointSubsystem();
+
+	// Enemies might have been destroyed by someone else in the meantime
+	ActiveEnemyArray.RemoveAllSwap([](APawn const* Enemy) { return !IsValid(Enemy); });
+
+	for (APawn* Enemy : ActiveEnemyArray)
+	{
+		FVector SpawnLocation;
+		ResetEnemy(Enemy, SpawnPoints->TakeSpawnPoint(SpawnLocation) ? SpawnLocation : Enemy->GetActorLocation());
+
+		OnEnemyActivated.Broadcast(Enemy);
+	}
+
+	bIsSpawning = true;
+}
+
+bool UEnemySpawnerSubsystem::IsSpawning() const
+{
+	return bIsSpawning;
+}
+
+TArray<APawn*> const& UEnemySpawnerSubsystem::GetActiveEnemies() const
+{
+	return ActiveEnemyArray;
+}
+
+bool UEnemySpawnerSubsystem::DoesSupportWorldType(EWorldType::Type const WorldType) const
+{
+	return WorldType == EWorldType::Game
+		|| WorldType == EWorldType::PIE;
+}
+
+APawn* UEnemySpawnerSubsystem::SpawnEnemy()
+{
+	USpawnPointSubsystem* SpawnPoints = GetSpawnPointSubsystem();
+
+	// Each point is tried once at most, if none of them works, there's no room left for the enemy anyway
+	APawn* Enemy = nullptr;
+	FVector SpawnLocation;
+	for (int32 Attempt = 0, MaxAttempts = SpawnPoints->GetNumSpawnPoints();
+		 !Enemy && Attempt < MaxAttempts && SpawnPoints->TakeSpawnPoint(SpawnLocation); ++Attempt)
+	{
+		Enemy = GetWorld()->SpawnActor<APawn>(EnemyClass, SpawnLocation, FRotator::ZeroRotator);
+	}
+
+	if (Enemy && !Enemy->GetController())
+	{
+		Enemy->SpawnDefaultController();
+	}
+
+	return Enemy;
+}
+
+bool UEnemySpawnerSubsystem::ActivateEnemy(APawn* Enemy)
+{
+	FVector SpawnLocation;
+	if (!GetSpawnPointSubsystem()->TakeSpawnPoint(SpawnLocation))
+	{
+		return false;
+	}
+
+	Enemy->SetActorHiddenInGame(false);
+	Enemy->SetActorEnableCollision(true);
+	Enemy->SetActorTickEnabled(true);
+
+	if (AController* Controller = Enemy->GetController())
+	{
+		if (UQulockComponent* QulockComponent = Controller->FindComponentByClass<UQulockComponent>())
+		{
+			QulockComponent->Activate();
+		}
+	}
+
+	ResetEnemy(Enemy, SpawnLocation);
+	return true;
+}
+
+void UEnemySpawnerSubsystem::DeactivateEnemy(APawn* Enemy)
+{
+	Enemy->SetActorHiddenInGame(true);
+	Enemy->SetActorEnableCollision(false);
+	Enemy->SetActorTickEnabled(false);
+
+	if (AAIController* Controller = Cast<AAIController>(Enemy->GetController()))
+	{
+		Controller->StopMovement();
+
+		if (UBrainComponent* BrainComponent = Controller->GetBrainComponent())
+		{
+			BrainComponent->StopLogic(PooledReason.ToString());
+		}
+
+		// Disabling the actor's tick doesn't stop its components, pooled enemies shouldn't be evaluated (or replicated) as targets
+		if (UQulockComponent* QulockComponent = Controller->FindComponentByClass<UQulockComponent>())
+		{
+			QulockComponent->Deactivate();
+		}
+	}
+
+	if (ACharacter* Character = Cast<ACharacter>(Enemy))
+	{
+		Character->GetCharacterMovement()->SetMovementMode(MOVE_None);
+	}
+}
+
+void UEnemySpawnerSubsystem::ResetEnemy(APawn* Enemy, FVector const& Location)
+{
+	Enemy->SetActorLocationAndRotation(Location, FRotator::ZeroRotator, false, nullptr, ETeleportType::ResetPhysics);
+
+	if (ACharacter* Character = Cast<ACharacter>(Enemy))
+	{
+		Character->GetCharacterMovement()->StopMovementImmediately();
+	}
+
+	if (AAIController* Controller = Cast<AAIController>(Enemy->GetController()))
+	{
+		Controller->StopMovement();
+		Controller->ClearFocus(EAIFocusPriority::Gameplay);
+
+		if (UBrainComponent* BrainComponent = Controller->GetBrainComponent())
+		{
+			BrainComponent->RestartLogic();
+		}
+	}
+}
+
+USpawnPointSubsystem* UEnemySpawnerSubsystem::GetSpawnPointSubsystem() const
+{
+	return GetWorld()->GetGameInstance()->GetSubsystem<USpawnPointSubsystem>();
+}
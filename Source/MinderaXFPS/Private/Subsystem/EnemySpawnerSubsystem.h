@@ -0,0 +1,70 @@
+// Ricardo Santos, 2023
+
+#pragma once
+
+#include <CoreMinimal.h>
+#include <Subsystems/WorldSubsystem.h>
+
+#include "EnemySpawnerSubsystem.generated.h"
+
+// Keeps the requested number of enemies active, spawning them across frames under a time budget,
+// and reusing the ones that were deactivated instead of destroying them, along with their controllers.
+// Enemies are placed at the spawn points handed out by the USpawnPointSubsystem, which must be prepared beforehand.
+UCLASS()
+class UEnemySpawnerSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Activates pooled enemies first, and spawns the rest over the next frames; any extra active enemies go back to the pool
+	void SetNumActiveEnemies(TSubclassOf<APawn> EnemyClass, int32 NumEnemies);
+
+	// Moves every active enemy to a new spawn point, and restarts its behaviors, as if it had just been spawned
+	void ResetActiveEnemies();
+
+	bool IsSpawning() const;
+
+	TArray<APawn*> const& GetActiveEnemies() const;
+
+	// Whenever an enemy is spawned, or reused from the pool, and reset
+	DECLARE_MULTICAST_DELEGATE_OneParam(FEnemyActivatedEvent, APawn*);
+	FEnemyActivatedEvent OnEnemyActivated;
+
+	// Whenever an enemy goes back to the pool
+	DECLARE_MULTICAST_DELEGATE_OneParam(FEnemyDeactivatedEvent, APawn*);
+	FEnemyDeactivatedEvent OnEnemyDeactivated;
+
+	// Once all the requested enemies are active
+	DECLARE_MULTICAST_DELEGATE(FEnemiesReadyEvent);
+	FEnemiesReadyEvent OnEnemiesReady;
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type const WorldType) const override;
+
+private:
+	APawn* SpawnEnemy();
+	bool ActivateEnemy(APawn* Enemy);
+	void DeactivateEnemy(APawn* Enemy);
+
+	static void ResetEnemy(APawn* Enemy, FVector const& Location);
+
+	class USpawnPointSubsystem* GetSpawnPointSubsystem() const;
+
+	UPROPERTY()
+	TArray<APawn*> ActiveEnemyArray;
+
+	UPROPERTY()
+	TArray<APawn*> PooledEnemyArray;
+
+	UPROPERTY()
+	TSubclassOf<APawn> EnemyClass;
+
+	int32 NumRequestedEnemies = 0;
+	bool bIsSpawning = false;
+
+};
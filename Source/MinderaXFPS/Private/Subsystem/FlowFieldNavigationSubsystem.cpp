@@ -0,0 +1,304 @@
+// Ricardo Santos, 2023
+
+#include "Subsystem/FlowFieldNavigationSubsystem.h"
+
+#include <NavigationSystem.h>
+#include <NavMesh/RecastNavMesh.h>
+
+#include "Controllers/StalkerAIController.h"
+
+DECLARE_STATS_GROUP(TEXT("Flow Field Navigation"), STATGROUP_FlowFieldNavigation, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("Update Flow Fields"), STAT_UpdateFlowFields, STATGROUP_FlowFieldNavigation);
+DECLARE_CYCLE_STAT(TEXT("Steer Followers"), STAT_SteerFollowers, STATGROUP_FlowFieldNavigation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Expanded Polys"), STAT_ExpandedPolys, STATGROUP_FlowFieldNavigation);
+
+namespace
+{
+	int32 MaxPolyExpansionsPerFrame = 2048;
+	FAutoConsoleVariableRef CVarMaxPolyExpansionsPerFrame(
+		TEXT("FlowField.MaxPolyExpansionsPerFrame"),
+		MaxPolyExpansionsPerFrame,
+		TEXT("How many navmesh polys all flow fields may expand per frame while being rebuilt."));
+
+	// How far into the portal, from the closest point to its center, followers aim, so they don't hug the corners
+	constexpr double PortalCenteringFactor = 0.3;
+
+	// How far, horizontally, a location may be from the closest point of a poly and still be on it
+	constexpr double OnPolyTolerance = 1.0;
+
+	auto FrontierPredicate = [](auto const& Lhs, auto const& Rhs)
+	{
+		return Lhs.Distance < Rhs.Distance;
+	};
+}
+
+void UFlowFieldNavigationSubsystem::Deinitialize()
+{
+	FollowerGoalMap.Reset();
+	FollowerPolyMap.Reset();
+	FlowFieldMap.Reset();
+
+	Super::Deinitialize();
+}
+
+void UFlowFieldNavigationSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	ARecastNavMesh const* RecastNavMesh = GetNavMesh();
+	if (!RecastNavMesh)
+	{
+		return;
+	}
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_UpdateFlowFields);
+
+		// Fields whose goal is gone aren't needed anymore, the remaining ones share the expansion budget
+		int32 ExpansionBudget = MaxPolyExpansionsPerFrame;
+		for (auto FlowFieldIter = FlowFieldMap.CreateIterator(); FlowFieldIter; ++FlowFieldIter)
+		{
+			if (AActor const* Goal = FlowFieldIter->Key.Get())
+			{
+				UpdateFlowField(Goal, FlowFieldIter->Value, RecastNavMesh, ExpansionBudget);
+			}
+			else
+			{
+				FlowFieldIter.RemoveCurrent();
+			}
+		}
+	}
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_SteerFollowers);
+
+		for (auto const& FollowerGoalPair : FollowerGoalMap)
+		{
+			SteerFollower(FollowerGoalPair.Key, FollowerGoalPair.Value, RecastNavMesh);
+		}
+	}
+}
+
+TStatId UFlowFieldNavigationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UFlowFieldNavigationSubsystem, STATGROUP_Tickables);
+}
+
+void UFlowFieldNavigationSubsystem::StartFollowing(AStalkerAIController* Follower, AActor* Goal)
+{
+	FollowerGoalMap.Add(Follower, Goal);
+	FlowFieldMap.FindOrAdd(Goal);
+}
+
+void UFlowFieldNavigationSubsystem::StopFollowing(AStalkerAIController* Follower)
+{
+	AActor* Goal;
+	if (!FollowerGoalMap.RemoveAndCopyValue(Follower, Goal))
+	{
+		return;
+	}
+
+	FollowerPolyMap.Remove(Follower);
+
+	// Nobody else is heading there, so there's no point in keeping the field up to date
+	TArray<AActor*> GoalArray;
+	FollowerGoalMap.GenerateValueArray(GoalArray);
+	if (!GoalArray.Contains(Goal))
+	{
+		FlowFieldMap.Remove(Goal);
+	}
+}
+
+bool UFlowFieldNavigationSubsystem::IsFollowing(AStalkerAIController const* Follower) const
+{
+	return FollowerGoalMap.Contains(Follower);
+}
+
+bool UFlowFieldNavigationSubsystem::GetNextWaypoint(AActor const* Goal, FVector const& Location, FVector& OutWaypoint) const
+{
+	FFlowField const* FlowFieldPtr = FlowFieldMap.Find(Goal);
+	ARecastNavMesh const* RecastNavMesh = GetNavMesh();
+	if (!FlowFieldPtr || !RecastNavMesh)
+	{
+		return false;
+	}
+
+	NavNodeRef const Poly = RecastNavMesh->FindNearestPoly(Location, RecastNavMesh->GetDefaultQueryExtent());
+	return GetNextWaypoint(*FlowFieldPtr, Poly, Location, OutWaypoint);
+}
+
+bool UFlowFieldNavigationSubsystem::DoesSupportWorldType(EWorldType::Type const WorldType) const
+{
+	return WorldType == EWorldType::Game
+		|| WorldType == EWorldType::PIE;
+}
+
+void UFlowFieldNavigationSubsystem::UpdateFlowField(AActor const* Goal, FFlowField& FlowField, ARecastNavMesh const* RecastNavMesh,
+													int32& InOutExpansionBudget) const
+{
+	FVector const GoalLocation = Goal->GetActorLocation();
+	NavNodeRef const GoalPoly = FindPoly(RecastNavMesh, GoalLocation, FlowField.CurrentGoalPoly);
+	if (GoalPoly == INVALID_NAVNODEREF)
+	{
+		return;
+	}
+
+	FlowField.CurrentGoalPoly = GoalPoly;
+
+	// Within the same poly, only the final waypoint changes;
+	// if the goal came back to it while another field was being built, that field is already stale.
+	if (GoalPoly == FlowField.GoalPoly)
+	{
+		FlowField.GoalLocation = GoalLocation;
+		FlowField.PendingGoalPoly = INVALID_NAVNODEREF;
+		FlowField.PendingNodeMap.Reset();
+		FlowField.FrontierHeap.Reset();
+		return;
+	}
+
+	// If the goal moved on before the field being built was done, the build carries on anyway:
+	// starting over every time it does would starve it for as long as the goal keeps moving.
+	if (GoalPoly == FlowField.PendingGoalPoly)
+	{
+		FlowField.PendingGoalLocation = GoalLocation;
+	}
+	else if (FlowField.PendingGoalPoly == INVALID_NAVNODEREF)
+	{
+		FlowField.PendingGoalPoly = GoalPoly;
+		FlowField.PendingGoalLocation = GoalLocation;
+		FlowField.PendingNodeMap.Reset();
+		FlowField.FrontierHeap.Reset();
+		FlowField.FrontierHeap.HeapPush({ GoalPoly, 0.0 }, FrontierPredicate);
+		FlowField.PendingNodeMap.Add(GoalPoly, { 0.0, INVALID_NAVNODEREF, GoalLocation, GoalLocation });
+	}
+
+	// Dijkstra from the goal outwards, between poly centers, each poly remembers the portal back towards the goal
+	TArray<FNavigationPortalEdge> NeighborArray;
+	while (InOutExpansionBudget > 0 && FlowField.FrontierHeap.Num() > 0)
+	{
+		FFlowFieldFrontierNode FrontierNode;
+		FlowField.FrontierHeap.HeapPop(FrontierNode, FrontierPredicate, false);
+
+		FFlowFieldNode const& Node = FlowField.PendingNodeMap[FrontierNode.Poly];
+		if (FrontierNode.Distance > Node.Distance)
+		{
+			continue;
+		}
+
+		--InOutExpansionBudget;
+		INC_DWORD_STAT(STAT_ExpandedPolys);
+
+		FVector PolyCenter;
+		RecastNavMesh->GetPolyCenter(FrontierNode.Poly, PolyCenter);
+
+		NeighborArray.Reset();
+		RecastNavMesh->GetPolyNeighbors(FrontierNode.Poly, NeighborArray);
+
+		for (FNavigationPortalEdge const& Neighbor : NeighborArray)
+		{
+			FVector NeighborCenter;
+			RecastNavMesh->GetPolyCenter(Neighbor.ToRef, NeighborCenter);
+
+			double const NeighborDistance = FrontierNode.Distance + FVector::Dist(PolyCenter, NeighborCenter);
+
+			FFlowFieldNode* NeighborNodePtr = FlowField.PendingNodeMap.Find(Neighbor.ToRef);
+			if (!NeighborNodePtr || NeighborDistance < NeighborNodePtr->Distance)
+			{
+				// The portal is shared, so the one from this poly to the neighbor is also the way back from it
+				FlowField.PendingNodeMap.Add(Neighbor.ToRef, { NeighborDistance, FrontierNode.Poly, Neighbor.Left, Neighbor.Right });
+				FlowField.FrontierHeap.HeapPush({ Neighbor.ToRef, NeighborDistance }, FrontierPredicate);
+			}
+		}
+	}
+
+	if (FlowField.FrontierHeap.Num() == 0)
+	{
+		FlowField.GoalPoly = FlowField.PendingGoalPoly;
+		FlowField.GoalLocation = FlowField.PendingGoalLocation;
+		FlowField.NodeMap = MoveTemp(FlowField.PendingNodeMap);
+
+		FlowField.PendingGoalPoly = INVALID_NAVNODEREF;
+		FlowField.PendingNodeMap.Reset();
+	}
+}
+
+void UFlowFieldNavigationSubsystem::SteerFollower(AStalkerAIController* Follower, AActor const* Goal, ARecastNavMesh const* RecastNavMesh)
+{
+	APawn* FollowerPawn = Follower ? Follower->GetPawn() : nullptr;
+	if (!FollowerPawn || !Goal || !Follower->CanExecuteMoveTo())
+	{
+		return;
+	}
+
+	FFlowField const* FlowFieldPtr = FlowFieldMap.Find(Goal);
+	if (!FlowFieldPtr)
+	{
+		return;
+	}
+
+	FVector const Location = FollowerPawn->GetActorLocation();
+
+	NavNodeRef& FollowerPoly = FollowerPolyMap.FindOrAdd(Follower, INVALID_NAVNODEREF);
+	FollowerPoly = FindPoly(RecastNavMesh, Location, FollowerPoly);
+
+	FVector Waypoint;
+	if (GetNextWaypoint(*FlowFieldPtr, FollowerPoly, Location, Waypoint))
+	{
+		FollowerPawn->AddMovementInput((Waypoint - Location).GetSafeNormal2D());
+	}
+}
+
+bool UFlowFieldNavigationSubsystem::GetNextWaypoint(FFlowField const& FlowField, NavNodeRef const Poly, FVector const& Location,
+													FVector& OutWaypoint) const
+{
+	if (FlowField.GoalPoly == INVALID_NAVNODEREF || Poly == INVALID_NAVNODEREF)
+	{
+		return false;
+	}
+
+	if (Poly == FlowField.GoalPoly)
+	{
+		OutWaypoint = FlowField.GoalLocation;
+		return true;
+	}
+
+	// Either unreachable, or the field hasn't been built yet
+	FFlowFieldNode const* NodePtr = FlowField.NodeMap.Find(Poly);
+	if (!NodePtr)
+	{
+		return false;
+	}
+
+	FVector PortalCenter = (NodePtr->PortalLeft + NodePtr->PortalRight) * 0.5;
+	FVector PortalPoint = FMath::ClosestPointOnSegment(Location, NodePtr->PortalLeft, NodePtr->PortalRight);
+	OutWaypoint = FMath::Lerp(PortalPoint, PortalCenter, PortalCenteringFactor);
+	return true;
+}
+
+NavNodeRef UFlowFieldNavigationSubsystem::FindPoly(ARecastNavMesh const* RecastNavMesh, FVector const& Location, NavNodeRef const LastPoly)
+{
+	FVector const QueryExtent = RecastNavMesh->GetDefaultQueryExtent();
+
+	// Most frames, nobody has left the poly they were on, and checking that is much cheaper than searching the tiles
+	FVector PointOnPoly;
+	if (LastPoly != INVALID_NAVNODEREF
+		&& RecastNavMesh->GetClosestPointOnPoly(LastPoly, Location, PointOnPoly)
+		&& FVector::DistSquared2D(PointOnPoly, Location) <= FMath::Square(OnPolyTolerance)
+		&& FMath::Abs(PointOnPoly.Z - Location.Z) <= QueryExtent.Z)
+	{
+		return LastPoly;
+	}
+
+	return RecastNavMesh->FindNearestPoly(Location, QueryExtent);
+}
+
+ARecastNavMesh* UFlowFieldNavigationSubsystem::GetNavMesh() const
+{
+	if (NavMesh)
+	{
+		return NavMesh;
+	}
+
+	UNavigationSystemV1* NavigationSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	return NavMesh = NavigationSystem ? Cast<ARecastNavMesh>(NavigationSystem->GetDefaultNavDataInstance()) : nullptr;
+}
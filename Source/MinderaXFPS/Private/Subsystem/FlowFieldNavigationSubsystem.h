@@ -0,0 +1,93 @@
+// Ricardo Santos, 2023
+
+#pragma once
+
+#include <CoreMinimal.h>
+#include <AI/Navigation/NavigationTypes.h>
+#include <Subsystems/WorldSubsystem.h>
+
+#include "FlowFieldNavigationSubsystem.generated.h"
+
+class AStalkerAIController;
+class ARecastNavMesh;
+
+// Steers every follower towards its goal through a single distance field per goal, built over the navmesh polys,
+// instead of each follower running its own path query; the cost of a field depends on the size of the map only.
+// Fields are rebuilt when their goal moves to another poly, a bounded number of polys per frame,
+// while followers keep using the previous field until the new one is complete; a build in progress always runs to completion,
+// even if the goal moved on in the meantime, and the next one starts from wherever the goal is by then.
+// Followers and goals keep the poly they were last found on, and only search the navmesh again once they leave it.
+UCLASS()
+class UFlowFieldNavigationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void StartFollowing(AStalkerAIController* Follower, AActor* Goal);
+	void StopFollowing(AStalkerAIController* Follower);
+
+	bool IsFollowing(AStalkerAIController const* Follower) const;
+
+	// The point the follower should head to next, i.e., somewhere along the portal to the next poly towards the goal
+	bool GetNextWaypoint(AActor const* Goal, FVector const& Location, FVector& OutWaypoint) const;
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type const WorldType) const override;
+
+private:
+	struct FFlowFieldNode
+	{
+		double Distance;
+		NavNodeRef NextPoly;
+		FVector PortalLeft;
+		FVector PortalRight;
+	};
+
+	struct FFlowFieldFrontierNode
+	{
+		NavNodeRef Poly;
+		double Distance;
+	};
+
+	struct FFlowField
+	{
+		// Where the goal was found last, which isn't necessarily where the field was built for
+		NavNodeRef CurrentGoalPoly = INVALID_NAVNODEREF;
+
+		NavNodeRef GoalPoly = INVALID_NAVNODEREF;
+		FVector GoalLocation;
+		TMap<NavNodeRef, FFlowFieldNode> NodeMap;
+
+		// The field being built, swapped in once the frontier runs out
+		NavNodeRef PendingGoalPoly = INVALID_NAVNODEREF;
+		FVector PendingGoalLocation;
+		TMap<NavNodeRef, FFlowFieldNode> PendingNodeMap;
+		TArray<FFlowFieldFrontierNode> FrontierHeap;
+	};
+
+	void UpdateFlowField(AActor const* Goal, FFlowField& FlowField, ARecastNavMesh const* NavMesh, int32& InOutExpansionBudget) const;
+	void SteerFollower(AStalkerAIController* Follower, AActor const* Goal, ARecastNavMesh const* NavMesh);
+
+	bool GetNextWaypoint(FFlowField const& FlowField, NavNodeRef Poly, FVector const& Location, FVector& OutWaypoint) const;
+
+	// Only searches the navmesh if the location isn't on the poly it was found on last time anymore
+	static NavNodeRef FindPoly(ARecastNavMesh const* NavMesh, FVector const& Location, NavNodeRef LastPoly);
+
+	ARecastNavMesh* GetNavMesh() const;
+
+	UPROPERTY()
+	TMap<AStalkerAIController*, AActor*> FollowerGoalMap;
+
+	TMap<AStalkerAIController const*, NavNodeRef> FollowerPolyMap;
+
+	TMap<TWeakObjectPtr<AActor const>, FFlowField> FlowFieldMap;
+
+	UPROPERTY()
+	mutable ARecastNavMesh* NavMesh = nullptr;
+
+};
@@ -2,20 +2,221 @@
 
 #include "Subsystem/PlayerViewDataCachingSubsystem.h"
 
+#include <Camera/PlayerCameraManager.h>
+#include <Engine/LocalPlayer.h>
+#include <GameFramework/GameModeBase.h>
+#include <Math/PerspectiveMatrix.h>
+#include <SceneView.h>
+
+#include "Components/QulockComponent.h"
+
+// Builds the view straight from the camera manager's POV, instead of going through ULocalPlayer::CalcSceneViewInitOptions
+#define VIEWDATA_SHOULD_USE_CAMERA_POV 1
+
 DECLARE_STATS_GROUP(TEXT("Player ViewData Caching Subsystem"), STATGROUP_ViewDataCaching, STATCAT_Advanced);
 DECLARE_CYCLE_STAT(TEXT("Update Player ViewData"), STAT_UpdatePlayerViewData, STATGROUP_ViewDataCaching);
 
+namespace
+{
+	float RemoteViewMinAspectRatio = 4.f / 3.f;
+	FAutoConsoleVariableRef CVarRemoteViewMinAspectRatio(
+		TEXT("ViewData.RemoteViewMinAspectRatio"),
+		RemoteViewMinAspectRatio,
+		TEXT("Narrowest aspect ratio the views of remote players, whose viewports the server knows nothing about, are padded for."));
+
+	float RemoteViewMaxAspectRatio = 32.f / 9.f;
+	FAutoConsoleVariableRef CVarRemoteViewMaxAspectRatio(
+		TEXT("ViewData.RemoteViewMaxAspectRatio"),
+		RemoteViewMaxAspectRatio,
+		TEXT("Widest aspect ratio the views of remote players, whose viewports the server knows nothing about, are padded for."));
+
+	// Only the shape of the rectangle matters, the view data is resolution independent otherwise
+	constexpr int32 RemoteViewWidth = 1920;
+
+	// Swaps the axes so that the view looks down Z
+	FMatrix MakeViewRotationMatrix(FRotator const& ViewRotation)
+	{
+		return FInverseRotationMatrix(ViewRotation) * FMatrix(
+			FPlane(0, 0, 1, 0),
+			FPlane(1, 0, 0, 0),
+			FPlane(0, 1, 0, 0),
+			FPlane(0, 0, 0, 1));
+	}
+
+	bool ComputeLocalProjectionData(ULocalPlayer* Player, FSceneViewProjectionData& OutProjectionData)
+	{
+		APlayerController* PlayerController = Player->PlayerController;
+		FViewport* Viewport = Player->ViewportClient ? Player->ViewportClient->Viewport : nullptr;
+		if (!PlayerController || !PlayerController->PlayerCameraManager || !Viewport)
+		{
+			return false;
+		}
+
+#if VIEWDATA_SHOULD_USE_CAMERA_POV
+		// This is the same POV that CalcSceneViewInitOptions ends up with,
+		// minus the view state, stereo and view extension work we have no use for
+		FMinimalViewInfo const& CameraView = PlayerController->PlayerCameraManager->GetCameraCacheView();
+
+		// Same as in ULocalPlayer::GetProjectionData, so that split screen players get their own slice of the viewport
+		FIntPoint const ViewportSize = Viewport->GetSizeXY();
+		FIntPoint const ViewportPosition = Viewport->GetInitialPositionXY();
+		int32 const ViewX = FMath::TruncToInt(Player->Origin.X * ViewportSize.X) + ViewportPosition.X;
+		int32 const ViewY = FMath::TruncToInt(Player->Origin.Y * ViewportSize.Y) + ViewportPosition.Y;
+		int32 const ViewSizeX = FMath::TruncToInt(Player->Size.X * ViewportSize.X);
+		int32 const ViewSizeY = FMath::TruncToInt(Player->Size.Y * ViewportSize.Y);
+		if (ViewSizeX <= 0 || ViewSizeY <= 0)
+		{
+			return false;
+		}
+		
+		OutProjectionData.SetViewRectangle(FIntRect(ViewX, ViewY, ViewX + ViewSizeX, ViewY + ViewSizeY));
+		OutProjectionData.ViewOrigin = CameraView.Location;
+		OutProjectionData.ViewRotationMatrix = MakeViewRotationMatrix(CameraView.Rotation);
+		
+		FMinimalViewInfo::CalculateProjectionMatrixGivenView(CameraView, Player->AspectRatioAxisConstraint, Viewport, OutProjectionData);
+#else
+		FSceneViewInitOptions InitOptions;
+		Player->CalcSceneViewInitOptions(InitOptions, Viewport, nullptr);
+		OutProjectionData = InitOptions;
+#endif
+
+		return true;
+	}
+
+	bool ComputeRemoteProjectionData(APlayerController* PlayerController, FSceneViewProjectionData& OutProjectionData)
+	{
+		APawn const* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+		if (!Pawn || !PlayerController->PlayerCameraManager)
+		{
+			return false;
+		}
+
+		// The server doesn't run the camera of remote players, but their pawn's eyes follow the control rotation
+		// their client sends along with every move, which is as close to their camera's POV as it gets.
+		FMinimalViewInfo RemoteView;
+		Pawn->GetActorEyesViewPoint(RemoteView.Location, RemoteView.Rotation);
+		RemoteView.FOV = PlayerController->PlayerCameraManager->GetFOVAngle();
+
+		// Clients constrain their FOV like any local player would, but their aspect ratio could be anything,
+		// so the frustum is padded to contain theirs, for every aspect ratio in range; each axis is widest at either end of it.
+		EAspectRatioAxisConstraint const AxisConstraint = GetDefault<ULocalPlayer>()->AspectRatioAxisConstraint;
+		double const TanHalfFOV = FMath::Tan(FMath::DegreesToRadians(RemoteView.FOV * 0.5));
+		double TanHalfFOVX = 0.0;
+		double TanHalfFOVY = 0.0;
+		for (float const AspectRatio : { RemoteViewMinAspectRatio, RemoteViewMaxAspectRatio })
+		{
+			// Same as FMinimalViewInfo::CalculateProjectionMatrixGivenView
+			double const ClampedAspectRatio = FMath::Max(AspectRatio, UE_KINDA_SMALL_NUMBER);
+			bool const bIsXFOV = AxisConstraint == AspectRatio_MaintainXFOV
+							  || (AxisConstraint == AspectRatio_MajorAxisFOV && ClampedAspectRatio > 1.0);
+
+			TanHalfFOVX = FMath::Max(TanHalfFOVX, bIsXFOV ? TanHalfFOV : TanHalfFOV * ClampedAspectRatio);
+			TanHalfFOVY = FMath::Max(TanHalfFOVY, bIsXFOV ? TanHalfFOV / ClampedAspectRatio : TanHalfFOV);
+		}
+
+		int32 const ViewHeight = FMath::Max(FMath::TruncToInt(RemoteViewWidth * TanHalfFOVY / TanHalfFOVX), 1);
+		OutProjectionData.SetViewRectangle(FIntRect(0, 0, RemoteViewWidth, ViewHeight));
+		OutProjectionData.ViewOrigin = RemoteView.Location;
+		OutProjectionData.ViewRotationMatrix = MakeViewRotationMatrix(RemoteView.Rotation);
+		OutProjectionData.ProjectionMatrix = FReversedZPerspectiveMatrix(FMath::Atan(TanHalfFOVX), FMath::Atan(TanHalfFOVY),
+																		 1.f, 1.f, GNearClippingPlane, GNearClippingPlane);
+		
+		return true;
+	}
+}
+
+FPlayerViewData const* FPlayerViewSnapshot::Find(APlayerController const* Player) const
+{
+	for (int32 Index = 0; Index < NumPlayers; ++Index)
+	{
+		if (PlayerArray[Index] == Player)
+		{
+			return &ViewDataArray[Index];
+		}
+	}
+
+	return nullptr;
+}
+
+FPlayerViewSnapshot& FPlayerViewSnapshotBuffer::BeginWrite()
+{
+	int32 const WriteIndex = 1 - PublishedIndex.load(std::memory_order_relaxed);
+
+	// Odd means the buffer is being written, readers that were still copying it will retry
+	SequenceArray[WriteIndex].fetch_add(1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	
+	return SnapshotArray[WriteIndex];
+}
+
+void FPlayerViewSnapshotBuffer::EndWrite()
+{
+	int32 const WriteIndex = 1 - PublishedIndex.load(std::memory_order_relaxed);
+
+	SequenceArray[WriteIndex].fetch_add(1, std::memory_order_release);
+	PublishedIndex.store(WriteIndex, std::memory_order_release);
+}
+
+bool FPlayerViewSnapshotBuffer::Read(FPlayerViewSnapshot& OutSnapshot) const
+{
+	// The game thread writes once per frame, so a couple of attempts is plenty
+	for (int32 Attempt = 0; Attempt < 4; ++Attempt)
+	{
+		int32 const ReadIndex = PublishedIndex.load(std::memory_order_acquire);
+		
+		uint32 const BeginSequence = SequenceArray[ReadIndex].load(std::memory_order_acquire);
+		if (BeginSequence & 1)
+		{
+			continue;
+		}
+		
+		OutSnapshot = SnapshotArray[ReadIndex];
+		
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (SequenceArray[ReadIndex].load(std::memory_order_relaxed) == BeginSequence)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void FPlayerViewDataTickFunction::ExecuteTick(float, ELevelTick, ENamedThreads::Type, FGraphEventRef const&)
+{
+	if (Target)
+	{
+		Target->HandleUpdatePlayerViewData();
+	}
+}
+
+FString FPlayerViewDataTickFunction::DiagnosticMessage()
+{
+	return TEXT("FPlayerViewDataTickFunction");
+}
+
 void UPlayerViewDataCachingSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 {
 	Super::Initialize(Collection);
-	
-	LastUpdatedFrame = 0;
+
+	PlayerViewDataTickFunction.TickGroup = TG_PrePhysics;
+	PlayerViewDataTickFunction.bCanEverTick = true;
+	PlayerViewDataTickFunction.bHighPriority = true;
+	PlayerViewDataTickFunction.bTickEvenWhenPaused = true;
+	PlayerViewDataTickFunction.Target = this;
+
+	LogoutHandle = FGameModeEvents::GameModeLogoutEvent.AddUObject(this, &UPlayerViewDataCachingSubsystem::HandleLogout);
 }
 
 void UPlayerViewDataCachingSubsystem::Deinitialize()
 {
-	FWorldDelegates::OnWorldPreActorTick.Remove(PreActorTickDelegateHandle);
-	PreActorTickDelegateHandle.Reset();
+	if (PlayerViewDataTickFunction.IsTickFunctionRegistered())
+	{
+		PlayerViewDataTickFunction.UnRegisterTickFunction();
+	}
+
+	FGameModeEvents::GameModeLogoutEvent.Remove(LogoutHandle);
+	LogoutHandle.Reset();
 
 	PlayerViewDataMap.Reset();
 	
@@ -24,31 +225,43 @@ void UPlayerViewDataCachingSubsystem::Deinitialize()
 
 void UPlayerViewDataCachingSubsystem::SetupPlayerViewDataUpdate(APlayerController* PlayerController)
 {
-	ULocalPlayer* Player = PlayerController->GetLocalPlayer();
-	FPlayerViewData& ViewDataRef = PlayerViewDataMap.Add(Player);
+	// Every Qulock target sets up the same players, the entry we might already have is as good as a new one
+	PlayerViewDataMap.FindOrAdd(PlayerController);
 	
-	if (!PreActorTickDelegateHandle.IsValid())
+	if (!PlayerViewDataTickFunction.IsTickFunctionRegistered())
 	{
-		auto UpdateMemFuncPtr = &UPlayerViewDataCachingSubsystem::HandleUpdatePlayerViewData;
-		PreActorTickDelegateHandle = FWorldDelegates::OnWorldPreActorTick.AddUObject(this, UpdateMemFuncPtr);
+		PlayerViewDataTickFunction.RegisterTickFunction(GetWorld()->PersistentLevel);
 	}
+}
 
-	// We already ticked this frame, so update this player right now
-	if (LastUpdatedFrame == GFrameCounter)
+FPlayerViewData const& UPlayerViewDataCachingSubsystem::GetPlayerViewData(APlayerController* PlayerController)
+{
+	static FPlayerViewData const InvalidViewData;
+	
+	FPlayerViewDataEntry* ViewDataEntryPtr = PlayerViewDataMap.Find(PlayerController);
+	if (!ViewDataEntryPtr)
 	{
-		UpdatePlayerViewData(Player, ViewDataRef);
+		return InvalidViewData;
 	}
+
+	// We haven't ticked yet this frame, or the player was only set up after we did;
+	// it's published along with everyone else when we tick, so that a snapshot always has the whole frame.
+	if (ViewDataEntryPtr->LastUpdatedFrame != GFrameCounter)
+	{
+		UpdatePlayerViewData(PlayerController, *ViewDataEntryPtr);
+	}
+
+	return ViewDataEntryPtr->ViewData;
 }
 
-FPlayerViewData UPlayerViewDataCachingSubsystem::GetPlayerViewData(APlayerController* PlayerController) const
+bool UPlayerViewDataCachingSubsystem::HasPlayerViewData(APlayerController* PlayerController)
 {
-	ULocalPlayer* Player = PlayerController->GetLocalPlayer();
-	return LastUpdatedFrame == GFrameCounter ? PlayerViewDataMap.FindRef(Player) : FPlayerViewData{};
+	return GetPlayerViewData(PlayerController).bIsValid;
 }
 
-bool UPlayerViewDataCachingSubsystem::HasPlayerViewData(APlayerController* PlayerController) const
+bool UPlayerViewDataCachingSubsystem::ReadPlayerViewSnapshot(FPlayerViewSnapshot& OutSnapshot) const
 {
-	return GetPlayerViewData(PlayerController).bIsValid;
+	return PlayerViewSnapshotBuffer.Read(OutSnapshot);
 }
 
 bool UPlayerViewDataCachingSubsystem::DoesSupportWorldType(EWorldType::Type const WorldType) const
@@ -57,41 +270,104 @@ bool UPlayerViewDataCachingSubsystem::DoesSupportWorldType(EWorldType::Type cons
 		|| WorldType == EWorldType::PIE;
 }
 
-void UPlayerViewDataCachingSubsystem::HandleUpdatePlayerViewData(UWorld* World, ELevelTick, float)
+void UPlayerViewDataCachingSubsystem::HandleUpdatePlayerViewData()
 {
-	if (World == GetWorld())
+	for (auto& PlayerViewDataPair : PlayerViewDataMap)
 	{
-		for (auto& PlayerViewDataPair : PlayerViewDataMap)
-		{
-			ULocalPlayer* Player = PlayerViewDataPair.Key;
-			FPlayerViewData& ViewDataRef = PlayerViewDataPair.Value;
+		APlayerController* Player = PlayerViewDataPair.Key;
+		FPlayerViewDataEntry& ViewDataEntryRef = PlayerViewDataPair.Value;
 
-			UpdatePlayerViewData(Player, ViewDataRef);
+		// Every player is updated, even those nobody queried lately, since worker threads might still read them from the snapshot
+		if (ViewDataEntryRef.LastUpdatedFrame != GFrameCounter)
+		{
+			UpdatePlayerViewData(Player, ViewDataEntryRef);
 		}
-
-		LastUpdatedFrame = GFrameCounter;
 	}
+
+	PublishPlayerViewSnapshot();
 }
 
-void UPlayerViewDataCachingSubsystem::UpdatePlayerViewData(ULocalPlayer* Player, FPlayerViewData& ViewDataRef)
+void UPlayerViewDataCachingSubsystem::UpdatePlayerViewData(APlayerController* PlayerController, FPlayerViewDataEntry& ViewDataEntryRef)
 {
 	SCOPE_CYCLE_COUNTER(STAT_UpdatePlayerViewData);
+	CSV_SCOPED_TIMING_STAT(Qulock, UpdatePlayerViewData);
 
-	FSceneViewInitOptions ViewInitOptions;
-	Player->CalcSceneViewInitOptions(ViewInitOptions, Player->ViewportClient->Viewport, nullptr);
+	FPlayerViewData& ViewDataRef = ViewDataEntryRef.ViewData;
+	ViewDataEntryRef.LastUpdatedFrame = GFrameCounter;
+
+	// Players without a local player are remote ones, which only a server has
+	ULocalPlayer* Player = PlayerController ? PlayerController->GetLocalPlayer() : nullptr;
+
+	FSceneViewProjectionData ProjectionData;
+	bool const bHasProjectionData = Player
+		? ComputeLocalProjectionData(Player, ProjectionData)
+		: ComputeRemoteProjectionData(PlayerController, ProjectionData);
+	if (!bHasProjectionData)
+	{
+		ViewDataRef.bIsValid = false;
+		return;
+	}
 
 	// We probably don't need the view matrices,
-	// we can compute what we need directly from the init options;
+	// we can compute what we need directly from the projection data;
 	// note that FViewMatrices::Init does additional work based on the RHI/driver's state,
 	// if stuff is breaking, use the ViewMatrices instead.
 	
-//	FViewMatrices ViewMatrices	= ViewInitOptions;
+//	FViewMatrices ViewMatrices	= ProjectionData;
 
 //	ViewDataRef.ViewProjMatrix		= ViewMatrices.GetViewProjectionMatrix();
-	ViewDataRef.ViewProjMatrix		= ViewInitOptions.ComputeViewProjectionMatrix();
-	ViewDataRef.InvViewRotMatrix	= ViewInitOptions.ViewRotationMatrix.InverseFast();
+	ViewDataRef.ViewProjMatrix		= ProjectionData.ComputeViewProjectionMatrix();
+	ViewDataRef.InvViewRotMatrix	= ProjectionData.ViewRotationMatrix.InverseFast();
 //	ViewDataRef.ViewOrigin			= ViewMatrices.GetViewOrigin();
-	ViewDataRef.ViewOrigin			= ViewInitOptions.ViewOrigin;
-	ViewDataRef.ViewRectangle		= ViewInitOptions.GetConstrainedViewRect();
+	ViewDataRef.ViewOrigin			= ProjectionData.ViewOrigin;
+	ViewDataRef.ViewRectangle		= ProjectionData.GetConstrainedViewRect();
+
+	FMatrix const& ViewProjMatrix	= ViewDataRef.ViewProjMatrix;
+	ViewProjMatrix.GetFrustumLeftPlane(ViewDataRef.FrustumPlanes[0]);
+	ViewProjMatrix.GetFrustumRightPlane(ViewDataRef.FrustumPlanes[1]);
+	ViewProjMatrix.GetFrustumTopPlane(ViewDataRef.FrustumPlanes[2]);
+	ViewProjMatrix.GetFrustumBottomPlane(ViewDataRef.FrustumPlanes[3]);
+
+	// These are the axes of the player view's frame of reference
+	ViewDataRef.WorldRightDir		= ViewDataRef.InvViewRotMatrix.GetScaledAxis(EAxis::X);
+	ViewDataRef.WorldUpDir			= ViewDataRef.InvViewRotMatrix.GetScaledAxis(EAxis::Y);
 	ViewDataRef.bIsValid			= true;
 }
+
+void UPlayerViewDataCachingSubsystem::PublishPlayerViewSnapshot()
+{
+	FPlayerViewSnapshot& SnapshotRef = PlayerViewSnapshotBuffer.BeginWrite();
+	SnapshotRef.NumPlayers = 0;
+	SnapshotRef.Frame = GFrameCounter;
+
+	for (auto const& PlayerViewDataPair : PlayerViewDataMap)
+	{
+		// Readers copy the snapshot without ever blocking the game thread, so it can't grow, whoever doesn't fit is left out
+		if (!ensureMsgf(SnapshotRef.NumPlayers < FPlayerViewSnapshot::MaxPlayers,
+						TEXT("Only %d out of %d players fit in the player view snapshot, raise FPlayerViewSnapshot::MaxPlayers!"),
+						FPlayerViewSnapshot::MaxPlayers, PlayerViewDataMap.Num()))
+		{
+			break;
+		}
+
+		// Only this frame's data, stale entries would look valid to whoever reads them
+		FPlayerViewDataEntry const& ViewDataEntryRef = PlayerViewDataPair.Value;
+		if (ViewDataEntryRef.LastUpdatedFrame == GFrameCounter && ViewDataEntryRef.ViewData.bIsValid)
+		{
+			SnapshotRef.PlayerArray[SnapshotRef.NumPlayers] = PlayerViewDataPair.Key;
+			SnapshotRef.ViewDataArray[SnapshotRef.NumPlayers] = ViewDataEntryRef.ViewData;
+			++SnapshotRef.NumPlayers;
+		}
+	}
+
+	PlayerViewSnapshotBuffer.EndWrite();
+}
+
+void UPlayerViewDataCachingSubsystem::HandleLogout(AGameModeBase*, AController* Exiting)
+{
+	// Every world gets every logout, it's only ours if we have it
+	if (APlayerController* PlayerController = Cast<APlayerController>(Exiting))
+	{
+		PlayerViewDataMap.Remove(PlayerController);
+	}
+}
@@ -2,7 +2,10 @@
 
 #pragma once
 
+#include <atomic>
+
 #include <CoreMinimal.h>
+#include <Engine/EngineBaseTypes.h>
 #include <Subsystems/WorldSubsystem.h>
 
 #include "PlayerViewDataCachingSubsystem.generated.h"
@@ -16,9 +19,79 @@ struct FPlayerViewData
 	FMatrix		InvViewRotMatrix;
 	FVector		ViewOrigin;
 	FIntRect	ViewRectangle;
+
+	// Derived from the above once per frame, so that queries only have to do the target-dependent math
+	FPlane		FrustumPlanes[4]; // Normalized; left, right, top and bottom, in that order
+	FVector		WorldRightDir;
+	FVector		WorldUpDir;
+
 	bool		bIsValid = false;
 };
 
+// Every player's view data as of a given frame;
+// players are only identified by address, which is never dereferenced, so that this is safe to read from any thread.
+struct FPlayerViewSnapshot
+{
+	// Split screen only needs 4, a server needs one per connection; fixed, so a snapshot can be copied while it's written
+	static constexpr int32 MaxPlayers = 16;
+
+	FPlayerViewData const* Find(APlayerController const* Player) const;
+
+	APlayerController const* PlayerArray[MaxPlayers];
+	FPlayerViewData		ViewDataArray[MaxPlayers];
+	int32				NumPlayers = 0;
+	uint64				Frame = 0;
+};
+
+// The game thread writes into one buffer while readers read from the other one, which is published atomically once written.
+// Each buffer is guarded by a sequence number, odd while it's being written,
+// so that a reader that was too slow to copy a buffer before it got reused notices it and tries again.
+class FPlayerViewSnapshotBuffer
+{
+public:
+	// Game thread only
+	FPlayerViewSnapshot& BeginWrite();
+	void EndWrite();
+
+	// Any thread, never blocks the game thread; fails only if the game thread kept overwriting the buffer being copied
+	bool Read(FPlayerViewSnapshot& OutSnapshot) const;
+
+private:
+	FPlayerViewSnapshot SnapshotArray[2];
+	std::atomic<uint32> SequenceArray[2] = { 0, 0 };
+	std::atomic<int32> PublishedIndex = 0;
+};
+
+USTRUCT()
+struct FPlayerViewDataEntry
+{
+	GENERATED_BODY()
+
+	FPlayerViewData	ViewData;
+	uint64			LastUpdatedFrame = 0;
+};
+
+// Ticks with the world that owns the subsystem, before actors in the same group
+USTRUCT()
+struct FPlayerViewDataTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	class UPlayerViewDataCachingSubsystem* Target = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, FGraphEventRef const& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FPlayerViewDataTickFunction> : public TStructOpsTypeTraitsBase2<FPlayerViewDataTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
 UCLASS()
 class UPlayerViewDataCachingSubsystem : public UWorldSubsystem
 {
@@ -30,21 +103,36 @@ public:
 
 	void SetupPlayerViewDataUpdate(APlayerController* PlayerController);
 
-	FPlayerViewData GetPlayerViewData(APlayerController* PlayerController) const;
+	// The reference stays valid until another player is set up;
+	// players that weren't updated yet this frame are updated on demand
+	FPlayerViewData const& GetPlayerViewData(APlayerController* PlayerController);
+
+	bool HasPlayerViewData(APlayerController* PlayerController);
 
-	bool HasPlayerViewData(APlayerController* PlayerController) const;
+	// Copies the last published view data of every player, can be called from any thread;
+	// the snapshot is published once per frame, after every player's view data is updated, i.e., early in the frame.
+	bool ReadPlayerViewSnapshot(FPlayerViewSnapshot& OutSnapshot) const;
 	
 protected:
 	virtual bool DoesSupportWorldType(EWorldType::Type const WorldType) const override;
 
 private:
-	void HandleUpdatePlayerViewData(UWorld* World, ELevelTick LevelTickMode, float DeltaSeconds);
-	void UpdatePlayerViewData(ULocalPlayer* Player, FPlayerViewData& ViewDataRef);
+	friend FPlayerViewDataTickFunction;
+	
+	void HandleUpdatePlayerViewData();
+	void UpdatePlayerViewData(APlayerController* PlayerController, FPlayerViewDataEntry& ViewDataEntryRef);
+	void PublishPlayerViewSnapshot();
+
+	void HandleLogout(class AGameModeBase* GameMode, AController* Exiting);
 
+	// Local players, and on a server, remote ones too, whose view is rebuilt from what their client replicates
 	UPROPERTY()
-	TMap<ULocalPlayer*, FPlayerViewData> PlayerViewDataMap;
-	uint64 LastUpdatedFrame;
+	TMap<APlayerController*, FPlayerViewDataEntry> PlayerViewDataMap;
 	
-	FDelegateHandle PreActorTickDelegateHandle;
+	FPlayerViewDataTickFunction PlayerViewDataTickFunction;
+
+	FDelegateHandle LogoutHandle;
+
+	FPlayerViewSnapshotBuffer PlayerViewSnapshotBuffer;
 	
 };
@@ -0,0 +1,225 @@
+// Ricardo Santos, 2023
+
+#include "Subsystem/QulockBroadPhaseSubsystem.h"
+
+#include "Components/QulockComponent.h"
+#include "Subsystem/PlayerViewDataCachingSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Query Qulock Broad Phase"), STAT_QueryQulockBroadPhase, STATGROUP_QulockMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Broad Phase Rejected Cells"), STAT_BroadPhaseRejectedCells, STATGROUP_QulockMovement);
+
+namespace
+{
+	// Roughly the size of a room, stalkers are much smaller than this, so they rarely span more than a couple of cells
+	constexpr double CellSize = 1000.0;
+
+	FIntVector GetCell(FVector const& Location)
+	{
+		return FIntVector(FMath::FloorToInt32(Location.X / CellSize),
+						  FMath::FloorToInt32(Location.Y / CellSize),
+						  FMath::FloorToInt32(Location.Z / CellSize));
+	}
+
+	// Whether the box is completely outside any of the planes, we don't bother with the near plane
+	bool IsBoxOutsideFrustum(FVector const& Center, FVector const& Extent, FPlane const (&FrustumPlanes)[4])
+	{
+		for (FPlane const& Plane : FrustumPlanes)
+		{
+			double const Radius = FMath::Abs(Plane.X) * Extent.X + FMath::Abs(Plane.Y) * Extent.Y + FMath::Abs(Plane.Z) * Extent.Z;
+			if (Plane.PlaneDot(Center) > Radius)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+}
+
+void UQulockBroadPhaseSubsystem::Deinitialize()
+{
+	TargetCellsMap.Reset();
+	CellMap.Reset();
+	FrustumQueryMap.Reset();
+
+	Super::Deinitialize();
+}
+
+void UQulockBroadPhaseSubsystem::UpdateTarget(UQulockComponent const* QulockComponent, FBox const& TargetBounds)
+{
+	FTargetCells NewTargetCells{ TargetBounds, GetCell(TargetBounds.Min), GetCell(TargetBounds.Max), ++UpdateSerial };
+
+	if (FTargetCells* TargetCellsPtr = TargetCellsMap.Find(QulockComponent))
+	{
+		// Most moves don't leave the cells the target was already in
+		if (TargetCellsPtr->MinCell != NewTargetCells.MinCell || TargetCellsPtr->MaxCell != NewTargetCells.MaxCell)
+		{
+			RemoveFromCells(QulockComponent, *TargetCellsPtr);
+			AddToCells(QulockComponent, NewTargetCells);
+		}
+
+		*TargetCellsPtr = NewTargetCells;
+	}
+	else
+	{
+		AddToCells(QulockComponent, NewTargetCells);
+		TargetCellsMap.Add(QulockComponent, NewTargetCells);
+	}
+}
+
+void UQulockBroadPhaseSubsystem::RemoveTarget(UQulockComponent const* QulockComponent)
+{
+	FTargetCells TargetCells;
+	if (TargetCellsMap.RemoveAndCopyValue(QulockComponent, TargetCells))
+	{
+		RemoveFromCells(QulockComponent, TargetCells);
+	}
+}
+
+void UQulockBroadPhaseSubsystem::QueryPlayerFrustums()
+{
+	for (auto FrustumQueryIter = FrustumQueryMap.CreateIterator(); FrustumQueryIter; ++FrustumQueryIter)
+	{
+		// Players that left have no view data anymore, the ones that come back are queried again on their next lookup
+		if (!GetCachingSubsystem()->HasPlayerViewData(FrustumQueryIter.Key()))
+		{
+			FrustumQueryIter.RemoveCurrent();
+			continue;
+		}
+
+		if (FrustumQueryIter.Value().LastQueriedFrame != GFrameCounter)
+		{
+			QueryPlayerFrustum(FrustumQueryIter.Key(), FrustumQueryIter.Value());
+		}
+	}
+}
+
+void UQulockBroadPhaseSubsystem::GetPlayersWithTargetInFrustum(UQulockComponent const* QulockComponent, TSet<APlayerController*> const& PlayerSet,
+																TArray<APlayerController*, TInlineAllocator<4>>& OutPlayerArray)
+{
+	FTargetCells const* TargetCellsPtr = TargetCellsMap.Find(QulockComponent);
+	for (APlayerController* Player : PlayerSet)
+	{
+		if (!TargetCellsPtr || IsTargetWithinPlayerFrustum(QulockComponent, *TargetCellsPtr, Player))
+		{
+			OutPlayerArray.Add(Player);
+		}
+	}
+}
+
+bool UQulockBroadPhaseSubsystem::DoesSupportWorldType(EWorldType::Type const WorldType) const
+{
+	return WorldType == EWorldType::Game
+		|| WorldType == EWorldType::PIE;
+}
+
+bool UQulockBroadPhaseSubsystem::IsTargetWithinPlayerFrustum(UQulockComponent const* QulockComponent, FTargetCells const& TargetCells,
+															 APlayerController* Player)
+{
+	FPlayerFrustumQuery& FrustumQuery = FrustumQueryMap.FindOrAdd(Player);
+	if (FrustumQuery.LastQueriedFrame != GFrameCounter)
+	{
+		QueryPlayerFrustum(Player, FrustumQuery);
+	}
+
+	// Without a view we can't reject anything
+	if (!FrustumQuery.bHasView)
+	{
+		return true;
+	}
+
+	// Targets usually move after the evaluation tick, but the ones that moved since the query can't trust its results
+	if (TargetCells.UpdateSerial > FrustumQuery.QueriedSerial)
+	{
+		return !IsBoxOutsideFrustum(TargetCells.Bounds.GetCenter(), TargetCells.Bounds.GetExtent(), FrustumQuery.FrustumPlanes);
+	}
+
+	return FrustumQuery.PotentialTargetSet.Contains(QulockComponent);
+}
+
+void UQulockBroadPhaseSubsystem::AddToCells(UQulockComponent const* QulockComponent, FTargetCells const& TargetCells)
+{
+	for (int32 X = TargetCells.MinCell.X; X <= TargetCells.MaxCell.X; ++X)
+	{
+		for (int32 Y = TargetCells.MinCell.Y; Y <= TargetCells.MaxCell.Y; ++Y)
+		{
+			for (int32 Z = TargetCells.MinCell.Z; Z <= TargetCells.MaxCell.Z; ++Z)
+			{
+				CellMap.FindOrAdd(FIntVector(X, Y, Z)).Add(QulockComponent);
+			}
+		}
+	}
+}
+
+void UQulockBroadPhaseSubsystem::RemoveFromCells(UQulockComponent const* QulockComponent, FTargetCells const& TargetCells)
+{
+	for (int32 X = TargetCells.MinCell.X; X <= TargetCells.MaxCell.X; ++X)
+	{
+		for (int32 Y = TargetCells.MinCell.Y; Y <= TargetCells.MaxCell.Y; ++Y)
+		{
+			for (int32 Z = TargetCells.MinCell.Z; Z <= TargetCells.MaxCell.Z; ++Z)
+			{
+				FIntVector const Cell(X, Y, Z);
+				if (TArray<UQulockComponent const*>* CellTargetArrayPtr = CellMap.Find(Cell))
+				{
+					CellTargetArrayPtr->RemoveSwap(QulockComponent);
+					if (CellTargetArrayPtr->IsEmpty())
+					{
+						CellMap.Remove(Cell);
+					}
+				}
+			}
+		}
+	}
+}
+
+void UQulockBroadPhaseSubsystem::QueryPlayerFrustum(APlayerController* Player, FPlayerFrustumQuery& FrustumQuery)
+{
+	SCOPE_CYCLE_COUNTER(STAT_QueryQulockBroadPhase);
+
+	FrustumQuery.LastQueriedFrame = GFrameCounter;
+	FrustumQuery.QueriedSerial = UpdateSerial;
+	FrustumQuery.PotentialTargetSet.Reset();
+
+	FPlayerViewData const& PlayerViewData = GetCachingSubsystem()->GetPlayerViewData(Player);
+	FrustumQuery.bHasView = PlayerViewData.bIsValid;
+	if (!FrustumQuery.bHasView)
+	{
+		return;
+	}
+
+	for (int32 Index = 0; Index < 4; ++Index)
+	{
+		FrustumQuery.FrustumPlanes[Index] = PlayerViewData.FrustumPlanes[Index];
+	}
+
+	FVector const CellExtent{ CellSize * 0.5 };
+
+	// Only occupied cells are in the map, so this is bounded by the number of targets, not by the size of the frustum;
+	// targets are only visited in the cells that pass, which is what makes the rest of the frame's lookups cheap.
+	for (auto const& CellPair : CellMap)
+	{
+		FVector const CellCenter = (FVector(CellPair.Key) + 0.5) * CellSize;
+		if (IsBoxOutsideFrustum(CellCenter, CellExtent, PlayerViewData.FrustumPlanes))
+		{
+			INC_DWORD_STAT(STAT_BroadPhaseRejectedCells);
+			continue;
+		}
+
+		for (UQulockComponent const* QulockComponent : CellPair.Value)
+		{
+			FBox const& Bounds = TargetCellsMap[QulockComponent].Bounds;
+			if (!IsBoxOutsideFrustum(Bounds.GetCenter(), Bounds.GetExtent(), PlayerViewData.FrustumPlanes))
+			{
+				FrustumQuery.PotentialTargetSet.Add(QulockComponent);
+			}
+		}
+	}
+}
+
+UPlayerViewDataCachingSubsystem* UQulockBroadPhaseSubsystem::GetCachingSubsystem() const
+{
+	return CachingSubsystem
+		 ? CachingSubsystem
+		 : CachingSubsystem = GetWorld()->GetSubsystem<UPlayerViewDataCachingSubsystem>();
+}
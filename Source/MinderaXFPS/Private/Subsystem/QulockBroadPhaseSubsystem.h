@@ -0,0 +1,75 @@
+// Ricardo Santos, 2023
+
+#pragma once
+
+#include <CoreMinimal.h>
+#include <Subsystems/WorldSubsystem.h>
+
+#include "QulockBroadPhaseSubsystem.generated.h"
+
+class UQulockComponent;
+
+// Uniform grid of the bounds of every Qulock trace target, updated as they move.
+// Each player's frustum is tested against the occupied cells once per frame, from the evaluation tick,
+// and then against the targets in the cells that pass, so that the rest are rejected by a lookup.
+// Targets that move after their player's frustum was queried are tested as they are now instead.
+UCLASS()
+class UQulockBroadPhaseSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	void UpdateTarget(UQulockComponent const* QulockComponent, FBox const& TargetBounds);
+	void RemoveTarget(UQulockComponent const* QulockComponent);
+
+	// Queries the frustum of every player queried before, players that weren't are queried on their first lookup of the frame
+	void QueryPlayerFrustums();
+
+	// Conservative, targets that aren't in the grid are always potentially within every frustum;
+	// the target is looked up once, however many players there are.
+	void GetPlayersWithTargetInFrustum(UQulockComponent const* QulockComponent, TSet<APlayerController*> const& PlayerSet,
+									   TArray<APlayerController*, TInlineAllocator<4>>& OutPlayerArray);
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type const WorldType) const override;
+
+private:
+	struct FTargetCells
+	{
+		FBox Bounds;
+		FIntVector MinCell;
+		FIntVector MaxCell;
+		uint64 UpdateSerial;
+	};
+
+	struct FPlayerFrustumQuery
+	{
+		TSet<UQulockComponent const*> PotentialTargetSet;
+		FPlane FrustumPlanes[4];
+		uint64 LastQueriedFrame = 0;
+		uint64 QueriedSerial = 0;
+		bool bHasView = false;
+	};
+
+	bool IsTargetWithinPlayerFrustum(UQulockComponent const* QulockComponent, FTargetCells const& TargetCells, APlayerController* Player);
+
+	void AddToCells(UQulockComponent const* QulockComponent, FTargetCells const& TargetCells);
+	void RemoveFromCells(UQulockComponent const* QulockComponent, FTargetCells const& TargetCells);
+
+	void QueryPlayerFrustum(APlayerController* Player, FPlayerFrustumQuery& FrustumQuery);
+
+	class UPlayerViewDataCachingSubsystem* GetCachingSubsystem() const;
+
+	TMap<UQulockComponent const*, FTargetCells> TargetCellsMap;
+	TMap<FIntVector, TArray<UQulockComponent const*>> CellMap;
+	TMap<APlayerController*, FPlayerFrustumQuery> FrustumQueryMap;
+
+	// Incremented whenever a target moves, so queries can tell which targets moved after them
+	uint64 UpdateSerial = 0;
+
+	UPROPERTY()
+	mutable UPlayerViewDataCachingSubsystem* CachingSubsystem = nullptr;
+
+};
@@ -0,0 +1,765 @@
+// Ricardo Santos, 2023
+
+#include "Subsystem/QulockEvaluationSubsystem.h"
+
+#include <EngineUtils.h>
+
+#include "Components/QulockComponent.h"
+#include "Subsystem/PlayerViewDataCachingSubsystem.h"
+#include "Subsystem/QulockBroadPhaseSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Request Qulock Traces"), STAT_RequestQulockTraces, STATGROUP_QulockMovement);
+DECLARE_CYCLE_STAT(TEXT("Resolve Qulock Traces"), STAT_ResolveQulockTraces, STATGROUP_QulockMovement);
+DECLARE_CYCLE_STAT(TEXT("Schedule Qulock Targets"), STAT_ScheduleQulockTargets, STATGROUP_QulockMovement);
+DECLARE_CYCLE_STAT(TEXT("Publish Qulock Target Changes"), STAT_PublishQulockTargetChanges, STATGROUP_QulockMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Requested Qulock Targets"), STAT_RequestedQulockTargets, STATGROUP_QulockMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Reused Qulock Targets"), STAT_ReusedQulockTargets, STATGROUP_QulockMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Deferred Qulock Targets"), STAT_DeferredQulockTargets, STATGROUP_QulockMovement);
+
+namespace
+{
+	bool bUseScheduler = true;
+	FAutoConsoleVariableRef CVarUseScheduler(
+		TEXT("Qulock.Scheduler.Enabled"),
+		bUseScheduler,
+		TEXT("Whether Qulock targets are evaluated at a rate that depends on their significance, ")
+		TEXT("otherwise every target is evaluated every frame."));
+
+	float SchedulerBudgetMs = 1.f;
+	FAutoConsoleVariableRef CVarSchedulerBudgetMs(
+		TEXT("Qulock.Scheduler.BudgetMs"),
+		SchedulerBudgetMs,
+		TEXT("How long requesting the traces of Qulock targets may take per frame, in milliseconds; ")
+		TEXT("targets that don't fit are assumed to be observed until the next frame."));
+
+	float SchedulerMaxInterval = 0.2f;
+	FAutoConsoleVariableRef CVarSchedulerMaxInterval(
+		TEXT("Qulock.Scheduler.MaxInterval"),
+		SchedulerMaxInterval,
+		TEXT("How long the least significant Qulock targets may go without being evaluated, in seconds."));
+
+	float SchedulerSignificanceDistance = 5000.f;
+	FAutoConsoleVariableRef CVarSchedulerSignificanceDistance(
+		TEXT("Qulock.Scheduler.SignificanceDistance"),
+		SchedulerSignificanceDistance,
+		TEXT("Distance to the player's view beyond which Qulock targets are least significant."));
+
+	// Targets whose visibility changed less than this long ago are more significant
+	constexpr float RecentVisibilityChangeTime = 1.f;
+	constexpr float MinSignificance = 0.05f;
+}
+
+void FQulockEvaluationTickFunction::ExecuteTick(float, ELevelTick, ENamedThreads::Type, FGraphEventRef const&)
+{
+	if (Target)
+	{
+		Target->HandleEvaluateTargets();
+	}
+}
+
+FString FQulockEvaluationTickFunction::DiagnosticMessage()
+{
+	return TEXT("FQulockEvaluationTickFunction");
+}
+
+void UQulockEvaluationSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	LastRequestedFrame = 0;
+	LastResolvedFrame = 0;
+
+	EvaluationTickFunction.TickGroup = TG_PrePhysics;
+	EvaluationTickFunction.bCanEverTick = true;
+	EvaluationTickFunction.bHighPriority = true;
+	EvaluationTickFunction.Target = this;
+}
+
+void UQulockEvaluationSubsystem::Deinitialize()
+{
+	TargetArray.Reset();
+	TargetIndexMap.Reset();
+	PolledTargetArray.Reset();
+	RequestedTraceTargetArray.Reset();
+	TraceRequestArray.Reset();
+	EvaluatedTargetBits.Reset();
+	ObservedTargetBits.Reset();
+	ReusedTargetBits.Reset();
+	TargetScheduleArray.Reset();
+	ScheduledTargetArray.Reset();
+	IgnoredClassMap.Reset();
+
+	if (EvaluationTickFunction.IsTickFunctionRegistered())
+	{
+		EvaluationTickFunction.UnRegisterTickFunction();
+	}
+
+	if (ActorSpawnedHandle.IsValid())
+	{
+		GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+		ActorSpawnedHandle.Reset();
+	}
+
+	Super::Deinitialize();
+}
+
+void UQulockEvaluationSubsystem::RegisterQulockTarget(UQulockComponent* QulockComponent)
+{
+	if (!EvaluationTickFunction.IsTickFunctionRegistered())
+	{
+		EvaluationTickFunction.RegisterTickFunction(GetWorld()->PersistentLevel);
+	}
+
+	if (!QulockComponent->ShouldUseBatchedEvaluation())
+	{
+		PolledTargetArray.AddUnique(QulockComponent);
+		return;
+	}
+
+	if (TargetIndexMap.Contains(QulockComponent))
+	{
+		return;
+	}
+
+	int32 TargetIndex = TargetArray.Add(QulockComponent);
+	TargetIndexMap.Add(QulockComponent, TargetIndex);
+
+	RequestedTraceTargetArray.Add(nullptr);
+	EvaluatedTargetBits.Add(false);
+	ObservedTargetBits.Add(true);
+	ReusedTargetBits.Add(false);
+	TargetScheduleArray.AddDefaulted();
+}
+
+void UQulockEvaluationSubsystem::UnregisterQulockTarget(UQulockComponent* QulockComponent)
+{
+	if (PolledTargetArray.RemoveSwap(QulockComponent) > 0)
+	{
+		return;
+	}
+
+	int32 TargetIndex;
+	if (!TargetIndexMap.RemoveAndCopyValue(QulockComponent, TargetIndex))
+	{
+		return;
+	}
+
+	int32 LastTargetIndex = TargetArray.Num() - 1;
+
+	TargetArray.RemoveAtSwap(TargetIndex);
+	RequestedTraceTargetArray.RemoveAtSwap(TargetIndex);
+	EvaluatedTargetBits.RemoveAtSwap(TargetIndex);
+	ObservedTargetBits.RemoveAtSwap(TargetIndex);
+	ReusedTargetBits.RemoveAtSwap(TargetIndex);
+	TargetScheduleArray.RemoveAtSwap(TargetIndex);
+
+	if (TargetIndex != LastTargetIndex)
+	{
+		TargetIndexMap[TargetArray[TargetIndex]] = TargetIndex;
+	}
+
+	// Requests still in flight must follow the target that was swapped into the removed slot
+	for (FQulockTraceRequest& TraceRequest : TraceRequestArray)
+	{
+		if (TraceRequest.TargetIndex == TargetIndex)
+		{
+			TraceRequest.TargetIndex = INDEX_NONE;
+		}
+		else if (TraceRequest.TargetIndex == LastTargetIndex)
+		{
+			TraceRequest.TargetIndex = TargetIndex;
+		}
+	}
+}
+
+void UQulockEvaluationSubsystem::AddTargetTickPrerequisite(AActor* Target)
+{
+	if (!Target)
+	{
+		return;
+	}
+
+	// Movement ticks in TG_PrePhysics as well, so the group alone doesn't order us before it
+	Target->PrimaryActorTick.AddPrerequisite(this, EvaluationTickFunction);
+	Target->ForEachComponent(false, [this](UActorComponent* Component)
+	{
+		Component->PrimaryComponentTick.AddPrerequisite(this, EvaluationTickFunction);
+	});
+}
+
+void UQulockEvaluationSubsystem::RemoveTargetTickPrerequisite(AActor* Target)
+{
+	if (!Target)
+	{
+		return;
+	}
+
+	Target->PrimaryActorTick.RemovePrerequisite(this, EvaluationTickFunction);
+	Target->ForEachComponent(false, [this](UActorComponent* Component)
+	{
+		Component->PrimaryComponentTick.RemovePrerequisite(this, EvaluationTickFunction);
+	});
+}
+
+bool UQulockEvaluationSubsystem::IsTargetObserved(UQulockComponent const* QulockComponent)
+{
+	ResolveTargetTraces();
+
+	int32 const* TargetIndexPtr = TargetIndexMap.Find(QulockComponent);
+	return TargetIndexPtr ? ObservedTargetBits[*TargetIndexPtr] : true;
+}
+
+void UQulockEvaluationSubsystem::RegisterIgnoredClasses(TSet<TSubclassOf<AActor>> const& ClassSet)
+{
+	UWorld* World = GetWorld();
+
+	for (TSubclassOf<AActor> const& Class : ClassSet)
+	{
+		if (!Class)
+		{
+			continue;
+		}
+
+		int32& NumIgnoringComponents = IgnoredClassMap.FindOrAdd(Class);
+		if (NumIgnoringComponents++ > 0)
+		{
+			continue;
+		}
+
+		// Actors spawned from now on are handled as they come
+		for (TActorIterator<AActor> ActorIter{ World, Class }; ActorIter; ++ActorIter)
+		{
+			IgnoreQulockTraces(*ActorIter);
+		}
+	}
+
+	if (!ActorSpawnedHandle.IsValid() && !IgnoredClassMap.IsEmpty())
+	{
+		ActorSpawnedHandle = World->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &UQulockEvaluationSubsystem::HandleActorSpawned));
+	}
+}
+
+void UQulockEvaluationSubsystem::UnregisterIgnoredClasses(TSet<TSubclassOf<AActor>> const& ClassSet)
+{
+	// Actors that already ignore the channel are left as they are, only Qulock traces on it anyway
+	for (TSubclassOf<AActor> const& Class : ClassSet)
+	{
+		if (int32* NumIgnoringComponentsPtr = IgnoredClassMap.Find(Class); NumIgnoringComponentsPtr && --*NumIgnoringComponentsPtr <= 0)
+		{
+			IgnoredClassMap.Remove(Class);
+		}
+	}
+
+	if (ActorSpawnedHandle.IsValid() && IgnoredClassMap.IsEmpty())
+	{
+		GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+		ActorSpawnedHandle.Reset();
+	}
+}
+
+bool UQulockEvaluationSubsystem::DoesSupportWorldType(EWorldType::Type const WorldType) const
+{
+	return WorldType == EWorldType::Game
+		|| WorldType == EWorldType::PIE;
+}
+
+void UQulockEvaluationSubsystem::HandleEvaluateTargets()
+{
+	// Before any target is looked up, and before they move
+	GetBroadPhaseSubsystem()->QueryPlayerFrustums();
+
+	// Nobody might have asked for the results of the previous frame, but we still need them before requesting new ones
+	ResolveTargetTraces();
+	PublishTargetChanges();
+	RequestTargetTraces();
+}
+
+void UQulockEvaluationSubsystem::RequestTargetTraces()
+{
+	SCOPE_CYCLE_COUNTER(STAT_RequestQulockTraces);
+	CSV_SCOPED_TIMING_STAT(Qulock, RequestQulockTraces);
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(QulockRequestTraces, QulockChannel);
+
+	UWorld* World = GetWorld();
+	double const Time = World->GetTimeSeconds();
+	double const BudgetEndTime = FPlatformTime::Seconds() + SchedulerBudgetMs * 0.001;
+
+	LastRequestedFrame = GFrameCounter;
+	TraceRequestArray.Reset();
+	CapturedViewArray.Reset();
+	PendingCaptureArray.Reset();
+
+	ScheduleTargets(Time);
+
+#if QULOCK_WITH_FRAME_CAPTURE
+	bool const bIsCapturing = QulockFrameCapture::IsRecording();
+#else
+	bool const bIsCapturing = false;
+#endif
+	TMap<APlayerController*, int32> CapturedViewIndexMap;
+
+	TArray<FQulockViewTrace> ViewTraceArray;
+	TArray<FQulockViewTraceSource> ViewTraceSourceArray;
+	TArray<APlayerController*, TInlineAllocator<4>> PlayerArray;
+	for (int32 ScheduleIndex = 0; ScheduleIndex < ScheduledTargetArray.Num(); ++ScheduleIndex)
+	{
+		// Whatever doesn't fit stays unevaluated, i.e., observed, and becomes more overdue for the next frame
+		if (bUseScheduler && ScheduleIndex > 0 && FPlatformTime::Seconds() > BudgetEndTime)
+		{
+			INC_DWORD_STAT_BY(STAT_DeferredQulockTargets, ScheduledTargetArray.Num() - ScheduleIndex);
+			break;
+		}
+
+		int32 const TargetIndex = ScheduledTargetArray[ScheduleIndex].TargetIndex;
+		UQulockComponent* QulockComponent = TargetArray[TargetIndex];
+		AActor* Target = RequestedTraceTargetArray[TargetIndex].Get();
+
+		EvaluatedTargetBits[TargetIndex] = true;
+		TargetScheduleArray[TargetIndex].LastRequestedTime = Time;
+		INC_DWORD_STAT(STAT_RequestedQulockTargets);
+
+		// Targets outside every frustum are evaluated without any trace, i.e., unobserved
+		ViewTraceArray.Reset();
+		ViewTraceSourceArray.Reset();
+		int32 const FirstCaptureIndex = PendingCaptureArray.Num();
+		bool bIsCachedInView = false;
+
+		// The target's bounds are looked up in the broad phase once, for every player
+		PlayerArray.Reset();
+		QulockComponent->GetPlayersWithinBroadPhase(PlayerArray);
+
+		for (APlayerController* Player : PlayerArray)
+		{
+			// Any player seeing the target is enough
+			if (QulockComponent->IsCachedInView(Player, Target))
+			{
+				bIsCachedInView = true;
+				break;
+			}
+
+			int32 CaptureIndex = INDEX_NONE;
+			QulockFrameCapture::FCapturedEvaluation* CapturedEvaluation = nullptr;
+			if (bIsCapturing)
+			{
+				int32 const* ViewIndexPtr = CapturedViewIndexMap.Find(Player);
+				if (!ViewIndexPtr)
+				{
+					FPlayerViewData const& PlayerViewData = GetCachingSubsystem()->GetPlayerViewData(Player);
+					ViewIndexPtr = &CapturedViewIndexMap.Add(Player, CapturedViewArray.Add(QulockFrameCapture::CaptureView(PlayerViewData)));
+				}
+
+				CaptureIndex = PendingCaptureArray.Num();
+				FQulockPendingCapture& PendingCapture = PendingCaptureArray.AddDefaulted_GetRef();
+				PendingCapture.ViewIndex = *ViewIndexPtr;
+				CapturedEvaluation = &PendingCapture.Evaluation;
+			}
+
+			QulockComponent->ComputePlayerViewTraces(Player, Target, ViewTraceArray, CapturedEvaluation);
+			while (ViewTraceSourceArray.Num() < ViewTraceArray.Num())
+			{
+				ViewTraceSourceArray.Add({ Player, CaptureIndex });
+			}
+		}
+
+		if (bIsCachedInView)
+		{
+			// Cache hits aren't captured by the synchronous path either
+			PendingCaptureArray.SetNum(FirstCaptureIndex);
+
+			FQulockTraceRequest& TraceRequest = TraceRequestArray.AddDefaulted_GetRef();
+			TraceRequest.TargetIndex = TargetIndex;
+			TraceRequest.bIsCachedInView = true;
+			continue;
+		}
+
+		FCollisionQueryParams const& TraceParams = QulockComponent->GetTraceParams();
+		ECollisionChannel const TraceChannel = QulockComponent->GetTraceChannel();
+		bool const bDoesMissSeeTarget = QulockComponent->DoesTraceMissSeeTarget();
+		for (int32 ViewTraceIndex = 0; ViewTraceIndex < ViewTraceArray.Num(); ++ViewTraceIndex)
+		{
+			FQulockViewTrace const& ViewTrace = ViewTraceArray[ViewTraceIndex];
+			FQulockViewTraceSource const& ViewTraceSource = ViewTraceSourceArray[ViewTraceIndex];
+
+			FQulockTraceRequest& TraceRequest = TraceRequestArray.AddDefaulted_GetRef();
+			TraceRequest.TargetIndex = TargetIndex;
+			TraceRequest.Player = ViewTraceSource.Player;
+			TraceRequest.CaptureIndex = ViewTraceSource.CaptureIndex;
+			if (TraceRequest.CaptureIndex != INDEX_NONE)
+			{
+				PendingCaptureArray[TraceRequest.CaptureIndex].ViewTraceArray.Add(ViewTrace);
+			}
+			TraceRequest.bDoesMissSeeTarget = bDoesMissSeeTarget;
+			TraceRequest.TraceHandle = World->AsyncLineTraceByChannel(EAsyncTraceType::Single,
+																	   ViewTrace.Start, ViewTrace.End,
+																	   TraceChannel, TraceParams);
+			if (ViewTrace.bShouldProject)
+			{
+				TraceRequest.ProjectedTraceHandle = World->AsyncLineTraceByChannel(EAsyncTraceType::Single,
+																				   ViewTrace.Start, ViewTrace.ProjectedEnd,
+																				   TraceChannel, TraceParams);
+			}
+
+			QulockInstrumentation::CountTraces(ViewTrace.bShouldProject ? 2 : 1, ViewTrace.bShouldProject ? 1 : 0);
+		}
+	}
+}
+
+void UQulockEvaluationSubsystem::ResolveTargetTraces()
+{
+	// Async trace data is only available on the frame after it was requested
+	if (LastResolvedFrame == GFrameCounter || LastRequestedFrame == GFrameCounter)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_ResolveQulockTraces);
+	CSV_SCOPED_TIMING_STAT(Qulock, ResolveQulockTraces);
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(QulockResolveTraces, QulockChannel);
+
+	LastResolvedFrame = GFrameCounter;
+
+	if (!PendingCaptureArray.IsEmpty())
+	{
+		CaptureResolvedTraces();
+	}
+
+	// Evaluated targets are unobserved unless one of their traces hits them,
+	// targets that weren't due keep their last result (the scheduler made sure they have one),
+	// everything else is conservatively observed until we get to evaluate it.
+	for (int32 TargetIndex = 0; TargetIndex < TargetArray.Num(); ++TargetIndex)
+	{
+		AActor* Target = RequestedTraceTargetArray[TargetIndex].Get();
+		bool bIsCurrentTarget = Target && Target == TargetArray[TargetIndex]->GetTraceTarget();
+		bool bIsEvaluated = EvaluatedTargetBits[TargetIndex] && bIsCurrentTarget;
+
+		if (ReusedTargetBits[TargetIndex] && bIsCurrentTarget)
+		{
+			ObservedTargetBits[TargetIndex] = TargetScheduleArray[TargetIndex].bWasObserved;
+		}
+		else
+		{
+			ObservedTargetBits[TargetIndex] = !bIsEvaluated;
+			TargetScheduleArray[TargetIndex].EvaluatedTarget = bIsEvaluated ? Target : nullptr;
+		}
+	}
+
+	for (FQulockTraceRequest const& TraceRequest : TraceRequestArray)
+	{
+		if (TraceRequest.TargetIndex == INDEX_NONE || ObservedTargetBits[TraceRequest.TargetIndex])
+		{
+			continue;
+		}
+
+		if (TraceRequest.bIsCachedInView)
+		{
+			ObservedTargetBits[TraceRequest.TargetIndex] = true;
+			continue;
+		}
+
+		AActor* Target = RequestedTraceTargetArray[TraceRequest.TargetIndex].Get();
+
+		ETraceResult TraceResult = GetTraceResult(TraceRequest.TraceHandle, Target);
+		QulockInstrumentation::TraceLineTrace(TargetArray[TraceRequest.TargetIndex], nullptr, TraceResult, false);
+
+		if (TraceResult == ETraceResult::Missed && TraceRequest.bDoesMissSeeTarget)
+		{
+			TraceResult = ETraceResult::HitTarget;
+		}
+
+		bool bIsInView = TraceResult == ETraceResult::HitTarget
+					  || TraceResult == ETraceResult::Unavailable;
+
+		// Same as the synchronous path: the projected trace only matters if the first one hit the target,
+		// and only stops the target from being observed if it hits something else.
+		if (TraceResult == ETraceResult::HitTarget && TraceRequest.ProjectedTraceHandle.IsValid())
+		{
+			ETraceResult const ProjectedTraceResult = GetTraceResult(TraceRequest.ProjectedTraceHandle, Target);
+			QulockInstrumentation::TraceLineTrace(TargetArray[TraceRequest.TargetIndex], nullptr, ProjectedTraceResult, true);
+
+			bIsInView = ProjectedTraceResult != ETraceResult::HitOther;
+		}
+
+		if (bIsInView)
+		{
+			ObservedTargetBits[TraceRequest.TargetIndex] = true;
+
+			// Traces that didn't complete only make the target observed for this frame
+			APlayerController* Player = TraceRequest.Player.Get();
+			if (Player && TraceResult != ETraceResult::Unavailable)
+			{
+				TargetArray[TraceRequest.TargetIndex]->CacheVisibilityResult(Player, Target, true);
+			}
+		}
+	}
+
+	TraceRequestArray.Reset();
+
+	double const Time = GetWorld()->GetTimeSeconds();
+	for (int32 TargetIndex = 0; TargetIndex < TargetArray.Num(); ++TargetIndex)
+	{
+		FQulockTargetSchedule& Schedule = TargetScheduleArray[TargetIndex];
+		if (EvaluatedTargetBits[TargetIndex] && Schedule.EvaluatedTarget.IsValid())
+		{
+			bool const bIsObserved = ObservedTargetBits[TargetIndex];
+			QulockInstrumentation::TraceEvaluation(TargetArray[TargetIndex], bIsObserved, true);
+
+			if (bIsObserved != Schedule.bWasObserved)
+			{
+				Schedule.LastVisibilityChangeTime = Time;
+				Schedule.bWasObserved = bIsObserved;
+			}
+		}
+		
+		EvaluatedTargetBits[TargetIndex] = false;
+		ReusedTargetBits[TargetIndex] = false;
+	}
+}
+
+void UQulockEvaluationSubsystem::CaptureResolvedTraces()
+{
+	auto ToCapturedResult = [](ETraceResult const TraceResult)
+	{
+		return TraceResult == ETraceResult::HitTarget ? QulockFrameCapture::ETraceResult::HitTarget
+			 : TraceResult == ETraceResult::HitOther ? QulockFrameCapture::ETraceResult::HitOther
+			 : QulockFrameCapture::ETraceResult::Missed;
+	};
+
+	// The traces of each evaluation are recorded in the order they were requested, i.e., the order the synchronous path
+	// would have executed them in, up to the first one that sees the target, which is where it would have stopped.
+	for (FQulockTraceRequest const& TraceRequest : TraceRequestArray)
+	{
+		if (TraceRequest.CaptureIndex == INDEX_NONE)
+		{
+			continue;
+		}
+
+		FQulockPendingCapture& PendingCapture = PendingCaptureArray[TraceRequest.CaptureIndex];
+		FQulockViewTrace const& ViewTrace = PendingCapture.ViewTraceArray[PendingCapture.NumResolvedTraces++];
+		if (PendingCapture.bIsDiscarded || PendingCapture.Evaluation.bIsInView)
+		{
+			continue;
+		}
+
+		AActor* Target = TraceRequest.TargetIndex != INDEX_NONE ? RequestedTraceTargetArray[TraceRequest.TargetIndex].Get() : nullptr;
+		ETraceResult TraceResult = Target ? GetTraceResult(TraceRequest.TraceHandle, Target) : ETraceResult::Unavailable;
+		if (TraceResult == ETraceResult::Unavailable)
+		{
+			PendingCapture.bIsDiscarded = true;
+			continue;
+		}
+
+		TArray<QulockFrameCapture::FCapturedTrace>& CapturedTraceArray = PendingCapture.Evaluation.Traces;
+		CapturedTraceArray.Add({ ViewTrace.End, ToCapturedResult(TraceResult) });
+
+		// Same decisions as ResolveTargetTraces
+		if (TraceResult == ETraceResult::Missed && TraceRequest.bDoesMissSeeTarget)
+		{
+			TraceResult = ETraceResult::HitTarget;
+		}
+
+		if (TraceResult == ETraceResult::HitTarget && TraceRequest.ProjectedTraceHandle.IsValid())
+		{
+			ETraceResult const ProjectedTraceResult = GetTraceResult(TraceRequest.ProjectedTraceHandle, Target);
+			if (ProjectedTraceResult == ETraceResult::Unavailable)
+			{
+				PendingCapture.bIsDiscarded = true;
+				continue;
+			}
+
+			CapturedTraceArray.Add({ ViewTrace.ProjectedEnd, ToCapturedResult(ProjectedTraceResult) });
+			TraceResult = ProjectedTraceResult == ETraceResult::HitOther ? ETraceResult::HitOther : ETraceResult::HitTarget;
+		}
+
+		PendingCapture.Evaluation.bIsInView = TraceResult == ETraceResult::HitTarget;
+	}
+
+	for (FQulockPendingCapture& PendingCapture : PendingCaptureArray)
+	{
+		if (!PendingCapture.bIsDiscarded)
+		{
+			QulockFrameCapture::AddEvaluation(CapturedViewArray[PendingCapture.ViewIndex], MoveTemp(PendingCapture.Evaluation));
+		}
+	}
+
+	CapturedViewArray.Reset();
+	PendingCaptureArray.Reset();
+}
+
+void UQulockEvaluationSubsystem::PublishTargetChanges()
+{
+	SCOPE_CYCLE_COUNTER(STAT_PublishQulockTargetChanges);
+
+	// Listeners might end play on any target, so we iterate over a copy and skip the ones that already did
+	TArray<UQulockComponent*> PublishedTargetArray{ TargetArray };
+	PublishedTargetArray.Append(PolledTargetArray);
+
+	for (UQulockComponent* QulockComponent : PublishedTargetArray)
+	{
+		if (IsValid(QulockComponent) && QulockComponent->HasBegunPlay())
+		{
+			QulockComponent->PublishCanMove();
+		}
+	}
+}
+
+void UQulockEvaluationSubsystem::ScheduleTargets(double Time)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ScheduleQulockTargets);
+
+	ScheduledTargetArray.Reset();
+	
+	for (int32 TargetIndex = 0; TargetIndex < TargetArray.Num(); ++TargetIndex)
+	{
+		UQulockComponent* QulockComponent = TargetArray[TargetIndex];
+		AActor* Target = QulockComponent->GetTraceTarget();
+
+		RequestedTraceTargetArray[TargetIndex] = Target;
+		EvaluatedTargetBits[TargetIndex] = false;
+		ReusedTargetBits[TargetIndex] = false;
+
+		if (!Target)
+		{
+			continue;
+		}
+
+		FQulockTargetSchedule& Schedule = TargetScheduleArray[TargetIndex];
+		if (!bUseScheduler)
+		{
+			ScheduledTargetArray.Add({ TargetIndex, 0.0 });
+			continue;
+		}
+		
+		Schedule.Significance = ComputeTargetSignificance(QulockComponent, Target, Schedule, Time);
+
+		// Only a result for the same target can be kept, anything else has to be evaluated
+		bool const bHasResult = Schedule.EvaluatedTarget.Get() == Target;
+		double const Interval = SchedulerMaxInterval * (1.f - Schedule.Significance);
+		double const Overdue = (Time - Schedule.LastRequestedTime) / FMath::Max(Interval, UE_DOUBLE_KINDA_SMALL_NUMBER);
+		
+		if (bHasResult && Overdue < 1.0)
+		{
+			ReusedTargetBits[TargetIndex] = true;
+			INC_DWORD_STAT(STAT_ReusedQulockTargets);
+			continue;
+		}
+
+		// Targets that were deferred get more overdue every frame, so they can't be starved forever
+		double const Priority = bHasResult ? Schedule.Significance * Overdue : TNumericLimits<double>::Max();
+		ScheduledTargetArray.Add({ TargetIndex, Priority });
+	}
+
+	if (bUseScheduler)
+	{
+		ScheduledTargetArray.Sort([](FQulockScheduledTarget const& Lhs, FQulockScheduledTarget const& Rhs)
+		{
+			return Lhs.Priority > Rhs.Priority;
+		});
+	}
+}
+
+float UQulockEvaluationSubsystem::ComputeTargetSignificance(UQulockComponent const* QulockComponent, AActor const* Target,
+															FQulockTargetSchedule const& Schedule, double Time) const
+{
+	USceneComponent const* RootComponent = Target->GetRootComponent();
+	if (!RootComponent)
+	{
+		return 1.f;
+	}
+
+	FVector const TargetLocation = RootComponent->Bounds.Origin;
+	float const TargetRadius = RootComponent->Bounds.SphereRadius;
+
+	float Significance = MinSignificance;
+	for (APlayerController* Player : QulockComponent->GetPlayerControllerSet())
+	{
+		FPlayerViewData const& PlayerViewData = GetCachingSubsystem()->GetPlayerViewData(Player);
+		if (!PlayerViewData.bIsValid)
+		{
+			return 1.f;
+		}
+
+		// Anything that might already be in view has to be evaluated every frame
+		bool bIsWithinFrustum = true;
+		for (FPlane const& Plane : PlayerViewData.FrustumPlanes)
+		{
+			if (Plane.PlaneDot(TargetLocation) > TargetRadius)
+			{
+				bIsWithinFrustum = false;
+				break;
+			}
+		}
+
+		if (bIsWithinFrustum)
+		{
+			return 1.f;
+		}
+
+		// Otherwise, the closer the target is to the view, both in distance and in angle, the sooner it might get into it
+		FVector const ViewForwardDir = PlayerViewData.InvViewRotMatrix.GetScaledAxis(EAxis::Z);
+		FVector const ViewToTarget = TargetLocation - PlayerViewData.ViewOrigin;
+		double const Distance = ViewToTarget.Size();
+		
+		double const DistanceFactor = 1.0 - FMath::Min(Distance / SchedulerSignificanceDistance, 1.0);
+		double const AngleFactor = (FVector::DotProduct(ViewToTarget.GetSafeNormal(), ViewForwardDir) + 1.0) * 0.5;
+
+		Significance = FMath::Max(Significance, static_cast<float>(DistanceFactor * AngleFactor));
+	}
+
+	// Targets that just changed visibility are likely to change it again
+	float const RecencyFactor = 1.f - static_cast<float>(FMath::Min((Time - Schedule.LastVisibilityChangeTime) / RecentVisibilityChangeTime, 1.0));
+	
+	return FMath::Clamp(Significance + RecencyFactor * (1.f - Significance) * 0.5f, MinSignificance, 1.f);
+}
+
+UPlayerViewDataCachingSubsystem* UQulockEvaluationSubsystem::GetCachingSubsystem() const
+{
+	return CachingSubsystem
+		 ? CachingSubsystem
+		 : CachingSubsystem = GetWorld()->GetSubsystem<UPlayerViewDataCachingSubsystem>();
+}
+
+UQulockBroadPhaseSubsystem* UQulockEvaluationSubsystem::GetBroadPhaseSubsystem() const
+{
+	return BroadPhaseSubsystem
+		 ? BroadPhaseSubsystem
+		 : BroadPhaseSubsystem = GetWorld()->GetSubsystem<UQulockBroadPhaseSubsystem>();
+}
+
+UQulockEvaluationSubsystem::ETraceResult UQulockEvaluationSubsystem::GetTraceResult(FTraceHandle const& TraceHandle,
+																					 AActor const* Target) const
+{
+	FTraceDatum TraceDatum;
+	if (!GetWorld()->QueryTraceData(TraceHandle, TraceDatum))
+	{
+		return ETraceResult::Unavailable;
+	}
+
+	FHitResult const* HitResult = TraceDatum.OutHits.FindByPredicate([](FHitResult const& Hit){ return Hit.bBlockingHit; });
+	if (!HitResult)
+	{
+		return ETraceResult::Missed;
+	}
+
+	return HitResult->GetActor() == Target ? ETraceResult::HitTarget : ETraceResult::HitOther;
+}
+
+void UQulockEvaluationSubsystem::HandleActorSpawned(AActor* Actor)
+{
+	// There's only ever a handful of ignored classes
+	for (auto const& IgnoredClassPair : IgnoredClassMap)
+	{
+		if (Actor->IsA(IgnoredClassPair.Key))
+		{
+			IgnoreQulockTraces(Actor);
+			return;
+		}
+	}
+}
+
+void UQulockEvaluationSubsystem::IgnoreQulockTraces(AActor* Actor)
+{
+	Actor->ForEachComponent<UPrimitiveComponent>(false, [](UPrimitiveComponent* PrimitiveComponent)
+	{
+		PrimitiveComponent->SetCollisionResponseToChannel(ECC_QulockVisibility, ECR_Ignore);
+	});
+}
@@ -0,0 +1,180 @@
+// Ricardo Santos, 2023
+
+#pragma once
+
+#include <CoreMinimal.h>
+#include <WorldCollision.h>
+#include <Subsystems/WorldSubsystem.h>
+
+#include "Components/QulockFrameCapture.h"
+#include "Components/QulockInstrumentation.h"
+
+#include "QulockEvaluationSubsystem.generated.h"
+
+class UQulockComponent;
+
+// Ticks early in the frame, before the targets it's a prerequisite of
+USTRUCT()
+struct FQulockEvaluationTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	class UQulockEvaluationSubsystem* Target = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, FGraphEventRef const& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FQulockEvaluationTickFunction> : public TStructOpsTypeTraitsBase2<FQulockEvaluationTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
+// Evaluates the registered Qulock targets, batching all of their visibility traces through the async trace API.
+// Traces requested in one frame are resolved in the next one.
+// Targets are evaluated at a rate that depends on their significance, i.e., how likely they are to become visible soon,
+// and only as many as fit in the frame's budget; the ones that don't fit are assumed to be observed until they do.
+// Targets that aren't batched are polled instead; either way, every target gets its changes published once per frame,
+// in TG_PrePhysics, before the targets themselves tick, so they never move on a frame they were already observed on.
+UCLASS()
+class UQulockEvaluationSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	void RegisterQulockTarget(UQulockComponent* QulockComponent);
+	void UnregisterQulockTarget(UQulockComponent* QulockComponent);
+
+	// Makes the actor and its components tick after the changes of every target are published
+	void AddTargetTickPrerequisite(AActor* Target);
+	void RemoveTargetTickPrerequisite(AActor* Target);
+
+	// Targets that haven't been evaluated yet are conservatively considered observed
+	bool IsTargetObserved(UQulockComponent const* QulockComponent);
+
+	// Every actor of these classes, including the ones spawned later, ignores ECC_QulockVisibility;
+	// the world is only searched for actors of a class the first time it's registered.
+	void RegisterIgnoredClasses(TSet<TSubclassOf<AActor>> const& ClassSet);
+	void UnregisterIgnoredClasses(TSet<TSubclassOf<AActor>> const& ClassSet);
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type const WorldType) const override;
+
+private:
+	friend FQulockEvaluationTickFunction;
+
+	using ETraceResult = QulockInstrumentation::ETraceResult;
+
+	struct FQulockTraceRequest
+	{
+		int32 TargetIndex;
+		TWeakObjectPtr<APlayerController> Player;
+		FTraceHandle TraceHandle;
+		FTraceHandle ProjectedTraceHandle;
+		bool bDoesMissSeeTarget = false;
+
+		// Targets a player saw recently, per their visibility cache, are observed without tracing anything
+		bool bIsCachedInView = false;
+
+		int32 CaptureIndex = INDEX_NONE;
+	};
+
+	// One player's evaluation of a target, recorded as the synchronous path would have, once its traces are resolved
+	struct FQulockPendingCapture
+	{
+		int32 ViewIndex;
+		QulockFrameCapture::FCapturedEvaluation Evaluation;
+
+		// Same order as the trace requests of the evaluation
+		TArray<FQulockViewTrace> ViewTraceArray;
+		int32 NumResolvedTraces = 0;
+		bool bIsDiscarded = false;
+	};
+
+	struct FQulockViewTraceSource
+	{
+		APlayerController* Player;
+		int32 CaptureIndex;
+	};
+
+	struct FQulockTargetSchedule
+	{
+		TWeakObjectPtr<AActor> EvaluatedTarget;
+		double LastRequestedTime = 0.0;
+		double LastVisibilityChangeTime = 0.0;
+		float Significance = 1.f;
+		bool bWasObserved = true;
+	};
+
+	struct FQulockScheduledTarget
+	{
+		int32 TargetIndex;
+		double Priority;
+	};
+
+	void HandleEvaluateTargets();
+
+	void RequestTargetTraces();
+	void ResolveTargetTraces();
+	void PublishTargetChanges();
+
+	void CaptureResolvedTraces();
+
+	void ScheduleTargets(double Time);
+	float ComputeTargetSignificance(UQulockComponent const* QulockComponent, AActor const* Target,
+									FQulockTargetSchedule const& Schedule, double Time) const;
+
+	class UPlayerViewDataCachingSubsystem* GetCachingSubsystem() const;
+	class UQulockBroadPhaseSubsystem* GetBroadPhaseSubsystem() const;
+
+	ETraceResult GetTraceResult(FTraceHandle const& TraceHandle, AActor const* Target) const;
+
+	void HandleActorSpawned(AActor* Actor);
+
+	static void IgnoreQulockTraces(AActor* Actor);
+
+	UPROPERTY()
+	TArray<UQulockComponent*> TargetArray;
+	TMap<UQulockComponent const*, int32> TargetIndexMap;
+
+	UPROPERTY()
+	TArray<UQulockComponent*> PolledTargetArray;
+
+	TArray<TWeakObjectPtr<AActor>> RequestedTraceTargetArray;
+	TArray<FQulockTraceRequest> TraceRequestArray;
+
+	TBitArray<> EvaluatedTargetBits;
+	TBitArray<> ObservedTargetBits;
+
+	// Targets that weren't due for evaluation, and keep their last result instead
+	TBitArray<> ReusedTargetBits;
+	TArray<FQulockTargetSchedule> TargetScheduleArray;
+	TArray<FQulockScheduledTarget> ScheduledTargetArray;
+
+	// Only while recording a frame capture
+	TArray<QulockFrameCapture::FCapturedView> CapturedViewArray;
+	TArray<FQulockPendingCapture> PendingCaptureArray;
+
+	uint64 LastRequestedFrame;
+	uint64 LastResolvedFrame;
+
+	FQulockEvaluationTickFunction EvaluationTickFunction;
+
+	// How many registered Qulock components ignore each class
+	TMap<TSubclassOf<AActor>, int32> IgnoredClassMap;
+	FDelegateHandle ActorSpawnedHandle;
+
+	UPROPERTY()
+	mutable UPlayerViewDataCachingSubsystem* CachingSubsystem = nullptr;
+
+	UPROPERTY()
+	mutable UQulockBroadPhaseSubsystem* BroadPhaseSubsystem = nullptr;
+
+};
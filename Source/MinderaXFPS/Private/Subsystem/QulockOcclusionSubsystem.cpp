@@ -0,0 +1,407 @@
+// Ricardo Santos, 2023
+
+#include "Subsystem/QulockOcclusionSubsystem.h"
+
+#include <Algo/Sort.h>
+
+#include "Components/QulockComponent.h"
+#include "Subsystem/PlayerViewDataCachingSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Rasterize Qulock Occluders"), STAT_RasterizeQulockOccluders, STATGROUP_QulockMovement);
+DECLARE_CYCLE_STAT(TEXT("Test Qulock Occlusion"), STAT_TestQulockOcclusion, STATGROUP_QulockMovement);
+
+namespace
+{
+	// The vertexes of the box follow the same order as the Qulock bounds, i.e., bit 2 of the index flips X, bit 1 flips Y and bit 0 flips Z,
+	// so each face is the 4 vertexes that agree on one of those bits.
+	constexpr int32 BoxAxisBits[3] = { 4, 2, 1 };
+
+	// Projects a world position into depth buffer space: X and Y in pixels, Z holds the inverse depth;
+	// returns false if the position is too close or behind the view, we don't clip against the near plane.
+	bool ProjectToDepthBuffer(FVector const& Position, FMatrix const& ViewProjMat, FVector3f& OutBufferPosition)
+	{
+		FVector4 ClipPosition = ViewProjMat.TransformFVector4(FVector4(Position, 1.f));
+		if (ClipPosition.W < GNearClippingPlane)
+		{
+			return false;
+		}
+
+		double InvW = 1.0 / ClipPosition.W;
+		OutBufferPosition.X = (ClipPosition.X * InvW * 0.5 + 0.5) * FQulockDepthBuffer::Width;
+		OutBufferPosition.Y = (0.5 - ClipPosition.Y * InvW * 0.5) * FQulockDepthBuffer::Height;
+		OutBufferPosition.Z = InvW;
+
+		return true;
+	}
+
+	float Cross(FVector2f const& Origin, FVector2f const& A, FVector2f const& B)
+	{
+		return (A.X - Origin.X) * (B.Y - Origin.Y) - (A.Y - Origin.Y) * (B.X - Origin.X);
+	}
+
+	// Andrew's monotone chain, the silhouette of a box is the convex hull of its vertexes; returns the number of vertexes of the hull
+	int32 MakeConvexHull(FVector3f const (&BufferVertexes)[8], FVector2f (&OutHull)[8])
+	{
+		FVector2f Points[8];
+		for (int32 Index = 0; Index < 8; ++Index)
+		{
+			Points[Index] = FVector2f{ BufferVertexes[Index].X, BufferVertexes[Index].Y };
+		}
+
+		Algo::Sort(Points, [](FVector2f const& A, FVector2f const& B)
+		{
+			return A.X < B.X || (A.X == B.X && A.Y < B.Y);
+		});
+
+		FVector2f Hull[16];
+		int32 NumHull = 0;
+		for (int32 Index = 0; Index < 8; ++Index)
+		{
+			while (NumHull >= 2 && Cross(Hull[NumHull - 2], Hull[NumHull - 1], Points[Index]) <= 0.f)
+			{
+				--NumHull;
+			}
+
+			Hull[NumHull++] = Points[Index];
+		}
+
+		for (int32 Index = 6, LowerHull = NumHull + 1; Index >= 0; --Index)
+		{
+			while (NumHull >= LowerHull && Cross(Hull[NumHull - 2], Hull[NumHull - 1], Points[Index]) <= 0.f)
+			{
+				--NumHull;
+			}
+
+			Hull[NumHull++] = Points[Index];
+		}
+
+		// The last one closes the hull, it's the first one again
+		NumHull = FMath::Min(NumHull - 1, 8);
+		for (int32 Index = 0; Index < NumHull; ++Index)
+		{
+			OutHull[Index] = Hull[Index];
+		}
+
+		return NumHull;
+	}
+
+	// Half-space rasterizer, evaluates 4 pixels of a row at a time and keeps the nearest occluder in each pixel.
+	// Only the pixels the silhouette of the box covers entirely are written, i.e., each edge is evaluated at the corner of the pixel
+	// that minimizes it, and with the farthest depth of the box over the pixel, so the buffer never claims more than the occluder hides.
+	// Inside the silhouette the front of a convex box is as far as the farthest of its front faces, i.e., the smallest inverse depth;
+	// the inverse depth of a face is affine in screen space, so its minimum over a pixel is found the same way as the edges'.
+	void RasterizeBox(FVector2f const (&Hull)[8], int32 const NumHull, FVector3f const (&FaceDepthArray)[3], int32 const NumFaces,
+					  float* InvDepthData)
+	{
+		float HullArea = 0.f;
+		for (int32 Index = 0; Index < NumHull; ++Index)
+		{
+			HullArea += Cross(FVector2f::ZeroVector, Hull[Index], Hull[(Index + 1) % NumHull]);
+		}
+
+		if (NumHull < 3 || NumFaces == 0 || FMath::Abs(HullArea) < UE_SMALL_NUMBER)
+		{
+			return;
+		}
+
+		FBox2f HullBounds{ Hull, NumHull };
+
+		// MinX is aligned to the vector width, Width is a multiple of it, so a vector never goes past a row
+		int32 MinX = FMath::Max(FMath::FloorToInt32(HullBounds.Min.X), 0) & ~3;
+		int32 MaxX = FMath::Min(FMath::CeilToInt32(HullBounds.Max.X), FQulockDepthBuffer::Width);
+		int32 MinY = FMath::Max(FMath::FloorToInt32(HullBounds.Min.Y), 0);
+		int32 MaxY = FMath::Min(FMath::CeilToInt32(HullBounds.Max.Y), FQulockDepthBuffer::Height);
+
+		if (MinX >= MaxX || MinY >= MaxY)
+		{
+			return;
+		}
+
+		// Edge functions, E(X, Y) = A * X + B * Y + C, positive inside the hull, moved in by half a pixel along each axis,
+		// so that evaluating them at the center of the pixel is the same as evaluating them at its worst corner.
+		float Sign = HullArea > 0.f ? 1.f : -1.f;
+
+		FVector3f EdgeArray[8];
+		for (int32 Index = 0; Index < NumHull; ++Index)
+		{
+			FVector2f const& From = Hull[Index];
+			FVector2f const& To = Hull[(Index + 1) % NumHull];
+
+			float A = (From.Y - To.Y) * Sign;
+			float B = (To.X - From.X) * Sign;
+			EdgeArray[Index] = FVector3f{ A, B, -(A * From.X + B * From.Y) - 0.5f * (FMath::Abs(A) + FMath::Abs(B)) };
+		}
+
+		// Same for the depth of each front face, which is moved back by half a pixel instead
+		FVector3f DepthArray[3];
+		for (int32 Index = 0; Index < NumFaces; ++Index)
+		{
+			FVector3f const& FaceDepth = FaceDepthArray[Index];
+			DepthArray[Index] = FVector3f{ FaceDepth.X, FaceDepth.Y,
+										   FaceDepth.Z - 0.5f * (FMath::Abs(FaceDepth.X) + FMath::Abs(FaceDepth.Y)) };
+		}
+
+		VectorRegister4Float const Zero = VectorZeroFloat();
+		VectorRegister4Float const PixelOffsets = MakeVectorRegisterFloat(0.5f, 1.5f, 2.5f, 3.5f);
+
+		for (int32 Y = MinY; Y < MaxY; ++Y)
+		{
+			float PixelY = Y + 0.5f;
+
+			float* RowData = InvDepthData + Y * FQulockDepthBuffer::Width;
+			for (int32 X = MinX; X < MaxX; X += 4)
+			{
+				VectorRegister4Float PixelX = VectorAdd(VectorSetFloat1(float(X)), PixelOffsets);
+
+				VectorRegister4Float Mask = VectorCompareGE(VectorMultiplyAdd(PixelX, VectorSetFloat1(EdgeArray[0].X),
+																			  VectorSetFloat1(EdgeArray[0].Y * PixelY + EdgeArray[0].Z)), Zero);
+				for (int32 Index = 1; Index < NumHull; ++Index)
+				{
+					FVector3f const& Edge = EdgeArray[Index];
+					Mask = VectorBitwiseAnd(Mask, VectorCompareGE(VectorMultiplyAdd(PixelX, VectorSetFloat1(Edge.X),
+																					VectorSetFloat1(Edge.Y * PixelY + Edge.Z)), Zero));
+				}
+
+				if (VectorMaskBits(Mask) == 0)
+				{
+					continue;
+				}
+
+				VectorRegister4Float PixelDepth = VectorMultiplyAdd(PixelX, VectorSetFloat1(DepthArray[0].X),
+																	VectorSetFloat1(DepthArray[0].Y * PixelY + DepthArray[0].Z));
+				for (int32 Index = 1; Index < NumFaces; ++Index)
+				{
+					FVector3f const& Depth = DepthArray[Index];
+					PixelDepth = VectorMin(PixelDepth, VectorMultiplyAdd(PixelX, VectorSetFloat1(Depth.X),
+																		 VectorSetFloat1(Depth.Y * PixelY + Depth.Z)));
+				}
+
+				VectorRegister4Float CurrentDepth = VectorLoadAligned(RowData + X);
+				VectorStoreAligned(VectorSelect(Mask, VectorMax(CurrentDepth, PixelDepth), CurrentDepth), RowData + X);
+			}
+		}
+	}
+}
+
+void UQulockOcclusionSubsystem::Deinitialize()
+{
+	OccluderMap.Reset();
+	DepthBufferMap.Reset();
+
+	Super::Deinitialize();
+}
+
+void UQulockOcclusionSubsystem::RegisterOccluder(UObject const* Owner, TArray<TStaticArray<FVector, 8>> OccluderVertexesArray)
+{
+	OccluderMap.Add(Owner, MoveTemp(OccluderVertexesArray));
+	++OccluderEpoch;
+}
+
+void UQulockOcclusionSubsystem::UnregisterOccluder(UObject const* Owner)
+{
+	if (OccluderMap.Remove(Owner) > 0)
+	{
+		++OccluderEpoch;
+	}
+}
+
+bool UQulockOcclusionSubsystem::IsBoundsOccluded(APlayerController* Player, TStaticArray<FVector, 8> const& BoundsVertexes)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TestQulockOcclusion);
+
+	if (OccluderMap.IsEmpty())
+	{
+		return false;
+	}
+
+	FPlayerViewData const& PlayerViewData = GetCachingSubsystem()->GetPlayerViewData(Player);
+	if (!PlayerViewData.bIsValid)
+	{
+		return false;
+	}
+
+	FMatrix const& ViewProjMat = PlayerViewData.ViewProjMatrix;
+	FQulockDepthBuffer const& DepthBuffer = GetRasterizedDepthBuffer(Player, PlayerViewData);
+
+	// We test the screen rectangle of the bounds against their nearest depth, which is conservative
+	FBox2f ScreenBounds{ ForceInit };
+	float MaxInvDepth = 0.f;
+	for (FVector const& Vertex : BoundsVertexes)
+	{
+		FVector3f BufferVertex;
+		if (!ProjectToDepthBuffer(Vertex, ViewProjMat, BufferVertex))
+		{
+			return false;
+		}
+
+		ScreenBounds += FVector2f{ BufferVertex.X, BufferVertex.Y };
+		MaxInvDepth = FMath::Max(MaxInvDepth, BufferVertex.Z);
+	}
+
+	int32 MinX = FMath::Clamp(FMath::FloorToInt32(ScreenBounds.Min.X), 0, FQulockDepthBuffer::Width);
+	int32 MaxX = FMath::Clamp(FMath::CeilToInt32(ScreenBounds.Max.X), 0, FQulockDepthBuffer::Width);
+	int32 MinY = FMath::Clamp(FMath::FloorToInt32(ScreenBounds.Min.Y), 0, FQulockDepthBuffer::Height);
+	int32 MaxY = FMath::Clamp(FMath::CeilToInt32(ScreenBounds.Max.Y), 0, FQulockDepthBuffer::Height);
+
+	if (MinX >= MaxX || MinY >= MaxY)
+	{
+		return false;
+	}
+
+	constexpr int32 TileSize = FQulockDepthBuffer::TileSize;
+	for (int32 TileY = MinY / TileSize; TileY * TileSize < MaxY; ++TileY)
+	{
+		for (int32 TileX = MinX / TileSize; TileX * TileSize < MaxX; ++TileX)
+		{
+			int32 TileMinX = FMath::Max(TileX * TileSize, MinX);
+			int32 TileMaxX = FMath::Min(TileX * TileSize + TileSize, MaxX);
+			int32 TileMinY = FMath::Max(TileY * TileSize, MinY);
+			int32 TileMaxY = FMath::Min(TileY * TileSize + TileSize, MaxY);
+
+			// If even the farthest occluder of the tile is in front of the bounds, the whole tile is occluded
+			float TileMinInvDepth = DepthBuffer.TileMinInvDepthArray[TileY * FQulockDepthBuffer::NumTilesX + TileX];
+			if (TileMinInvDepth > MaxInvDepth)
+			{
+				continue;
+			}
+
+			for (int32 Y = TileMinY; Y < TileMaxY; ++Y)
+			{
+				for (int32 X = TileMinX; X < TileMaxX; ++X)
+				{
+					if (DepthBuffer.InvDepthArray[Y * FQulockDepthBuffer::Width + X] <= MaxInvDepth)
+					{
+						return false;
+					}
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+uint32 UQulockOcclusionSubsystem::GetOccluderEpoch() const
+{
+	return OccluderEpoch;
+}
+
+bool UQulockOcclusionSubsystem::DoesSupportWorldType(EWorldType::Type const WorldType) const
+{
+	return WorldType == EWorldType::Game
+		|| WorldType == EWorldType::PIE;
+}
+
+FQulockDepthBuffer const& UQulockOcclusionSubsystem::GetRasterizedDepthBuffer(APlayerController* Player,
+																			  FPlayerViewData const& PlayerViewData)
+{
+	FQulockDepthBuffer& DepthBuffer = DepthBufferMap.FindOrAdd(Player);
+	if (DepthBuffer.LastRasterizedFrame != GFrameCounter)
+	{
+		RasterizeOccluders(PlayerViewData.ViewProjMatrix, PlayerViewData.ViewOrigin, DepthBuffer);
+		DepthBuffer.LastRasterizedFrame = GFrameCounter;
+	}
+
+	return DepthBuffer;
+}
+
+void UQulockOcclusionSubsystem::RasterizeOccluders(FMatrix const& ViewProjMat, FVector const& ViewOrigin,
+												   FQulockDepthBuffer& DepthBuffer) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_RasterizeQulockOccluders);
+
+	DepthBuffer.InvDepthArray.Init(0.f, FQulockDepthBuffer::Width * FQulockDepthBuffer::Height);
+	float* InvDepthData = DepthBuffer.InvDepthArray.GetData();
+
+	for (auto const& OccluderPair : OccluderMap)
+	{
+		for (TStaticArray<FVector, 8> const& OccluderVertexes : OccluderPair.Value)
+		{
+			// Occluders crossing the near plane are skipped entirely, which only ever makes the test more conservative
+			FVector3f BufferVertexes[8];
+			bool bIsProjected = true;
+			for (int32 Index = 0; Index < 8 && bIsProjected; ++Index)
+			{
+				bIsProjected = ProjectToDepthBuffer(OccluderVertexes[Index], ViewProjMat, BufferVertexes[Index]);
+			}
+
+			if (!bIsProjected)
+			{
+				continue;
+			}
+
+			// Inverse depth planes of the faces that face the view, at most one of each pair of opposite faces;
+			// faces seen edge on have no plane on screen, but they don't bound the depth of anything inside the silhouette either.
+			FVector3f FaceDepthArray[3];
+			int32 NumFaces = 0;
+			for (int32 const AxisBit : BoxAxisBits)
+			{
+				int32 FaceIndexes[2][4];
+				FVector FaceCenters[2] = { FVector::ZeroVector, FVector::ZeroVector };
+				int32 NumFaceIndexes[2] = { 0, 0 };
+				for (int32 Index = 0; Index < 8; ++Index)
+				{
+					int32 const Side = (Index & AxisBit) ? 1 : 0;
+					FaceIndexes[Side][NumFaceIndexes[Side]++] = Index;
+					FaceCenters[Side] += OccluderVertexes[Index] * 0.25;
+				}
+
+				// Boxes don't shear, so the outward normal of either face is the direction from the opposite one
+				for (int32 Side = 0; Side < 2; ++Side)
+				{
+					FVector const Normal = FaceCenters[Side] - FaceCenters[1 - Side];
+					if (((ViewOrigin - FaceCenters[Side]) | Normal) <= 0.0)
+					{
+						continue;
+					}
+
+					// The first 3 vertexes of a face never line up, they only differ in one bit from the first
+					FVector3f const& V0 = BufferVertexes[FaceIndexes[Side][0]];
+					FVector3f const& V1 = BufferVertexes[FaceIndexes[Side][1]];
+					FVector3f const& V2 = BufferVertexes[FaceIndexes[Side][2]];
+
+					float Area = (V1.X - V0.X) * (V2.Y - V0.Y) - (V1.Y - V0.Y) * (V2.X - V0.X);
+					if (FMath::Abs(Area) < UE_SMALL_NUMBER)
+					{
+						continue;
+					}
+
+					// Solves D(X, Y) = A * X + B * Y + C through the 3 vertexes
+					float A = ((V1.Z - V0.Z) * (V2.Y - V0.Y) - (V2.Z - V0.Z) * (V1.Y - V0.Y)) / Area;
+					float B = ((V2.Z - V0.Z) * (V1.X - V0.X) - (V1.Z - V0.Z) * (V2.X - V0.X)) / Area;
+					FaceDepthArray[NumFaces++] = FVector3f{ A, B, V0.Z - A * V0.X - B * V0.Y };
+				}
+			}
+
+			FVector2f Hull[8];
+			int32 NumHull = MakeConvexHull(BufferVertexes, Hull);
+
+			RasterizeBox(Hull, NumHull, FaceDepthArray, NumFaces, InvDepthData);
+		}
+	}
+
+	DepthBuffer.TileMinInvDepthArray.SetNumUninitialized(FQulockDepthBuffer::NumTilesX * FQulockDepthBuffer::NumTilesY);
+	for (int32 TileY = 0; TileY < FQulockDepthBuffer::NumTilesY; ++TileY)
+	{
+		for (int32 TileX = 0; TileX < FQulockDepthBuffer::NumTilesX; ++TileX)
+		{
+			float TileMinInvDepth = TNumericLimits<float>::Max();
+			for (int32 Y = TileY * FQulockDepthBuffer::TileSize; Y < (TileY + 1) * FQulockDepthBuffer::TileSize; ++Y)
+			{
+				for (int32 X = TileX * FQulockDepthBuffer::TileSize; X < (TileX + 1) * FQulockDepthBuffer::TileSize; ++X)
+				{
+					TileMinInvDepth = FMath::Min(TileMinInvDepth, InvDepthData[Y * FQulockDepthBuffer::Width + X]);
+				}
+			}
+
+			DepthBuffer.TileMinInvDepthArray[TileY * FQulockDepthBuffer::NumTilesX + TileX] = TileMinInvDepth;
+		}
+	}
+}
+
+UPlayerViewDataCachingSubsystem* UQulockOcclusionSubsystem::GetCachingSubsystem() const
+{
+	return CachingSubsystem
+		 ? CachingSubsystem
+		 : CachingSubsystem = GetWorld()->GetSubsystem<UPlayerViewDataCachingSubsystem>();
+}
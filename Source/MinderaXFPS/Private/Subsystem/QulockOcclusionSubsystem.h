@@ -0,0 +1,68 @@
+// Ricardo Santos, 2023
+
+#pragma once
+
+#include <CoreMinimal.h>
+#include <Containers/StaticArray.h>
+#include <Subsystems/WorldSubsystem.h>
+
+#include "QulockOcclusionSubsystem.generated.h"
+
+struct FPlayerViewData;
+
+// Low resolution CPU depth buffer, storing the inverse depth (1/W) of the nearest occluder for each pixel, as far as it gets over it,
+// and only for occluders that cover the pixel entirely,
+// plus the farthest occluder of each tile, so that large bounds can be rejected a whole tile at a time.
+struct FQulockDepthBuffer
+{
+	static constexpr int32 Width = 128;
+	static constexpr int32 Height = 64;
+	static constexpr int32 TileSize = 8;
+	static constexpr int32 NumTilesX = Width / TileSize;
+	static constexpr int32 NumTilesY = Height / TileSize;
+
+	TArray<float, TAlignedHeapAllocator<16>> InvDepthArray;
+	TArray<float> TileMinInvDepthArray;
+	uint64 LastRasterizedFrame = 0;
+};
+
+// Rasterizes every registered occluder into a depth buffer per player view, once per frame and only on demand,
+// so that Qulock targets can be tested against it instead of tracing against the whole collision scene.
+UCLASS()
+class UQulockOcclusionSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	// Registering an owner again replaces its occluders, e.g., after they moved
+	void RegisterOccluder(UObject const* Owner, TArray<TStaticArray<FVector, 8>> OccluderVertexesArray);
+	void UnregisterOccluder(UObject const* Owner);
+
+	// Whether the bounds are completely hidden behind the occluders, from the player's point of view;
+	// bounds that cross the near plane are never considered occluded.
+	bool IsBoundsOccluded(APlayerController* Player, TStaticArray<FVector, 8> const& BoundsVertexes);
+
+	// Incremented whenever an occluder is added, moved or removed
+	uint32 GetOccluderEpoch() const;
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type const WorldType) const override;
+
+private:
+	FQulockDepthBuffer const& GetRasterizedDepthBuffer(APlayerController* Player, FPlayerViewData const& PlayerViewData);
+	void RasterizeOccluders(FMatrix const& ViewProjMat, FVector const& ViewOrigin, FQulockDepthBuffer& DepthBuffer) const;
+
+	class UPlayerViewDataCachingSubsystem* GetCachingSubsystem() const;
+
+	// Each occluder is an oriented box, i.e., 8 vertexes in world space, and each owner may have several of them
+	TMap<UObject const*, TArray<TStaticArray<FVector, 8>>> OccluderMap;
+	TMap<APlayerController*, FQulockDepthBuffer> DepthBufferMap;
+
+	uint32 OccluderEpoch = 0;
+
+	UPROPERTY()
+	mutable UPlayerViewDataCachingSubsystem* CachingSubsystem = nullptr;
+
+};
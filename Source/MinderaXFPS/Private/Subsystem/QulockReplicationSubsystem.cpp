@@ -0,0 +1,42 @@
+// Ricardo Santos, 2023
+
+#include "Subsystem/QulockReplicationSubsystem.h"
+
+#include "GameFramework/QulockReplicationInfo.h"
+
+void UQulockReplicationSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// Servers are already listening by now; standalone games evaluate everything locally, and clients get it replicated
+	ENetMode const NetMode = InWorld.GetNetMode();
+	if (NetMode == NM_DedicatedServer || NetMode == NM_ListenServer)
+	{
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.ObjectFlags |= RF_Transient;
+		InWorld.SpawnActor<AQulockReplicationInfo>(SpawnParameters);
+	}
+}
+
+void UQulockReplicationSubsystem::Deinitialize()
+{
+	ReplicationInfo = nullptr;
+
+	Super::Deinitialize();
+}
+
+AQulockReplicationInfo* UQulockReplicationSubsystem::GetReplicationInfo() const
+{
+	return ReplicationInfo;
+}
+
+void UQulockReplicationSubsystem::SetReplicationInfo(AQulockReplicationInfo* NewReplicationInfo)
+{
+	ReplicationInfo = NewReplicationInfo;
+}
+
+bool UQulockReplicationSubsystem::DoesSupportWorldType(EWorldType::Type const WorldType) const
+{
+	return WorldType == EWorldType::Game
+		|| WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,35 @@
+// Ricardo Santos, 2023
+
+#pragma once
+
+#include <CoreMinimal.h>
+#include <Subsystems/WorldSubsystem.h>
+
+#include "QulockReplicationSubsystem.generated.h"
+
+class AQulockReplicationInfo;
+
+// Spawns the replication info of the Qulock targets on servers, and finds it for everyone else once it's replicated.
+UCLASS()
+class UQulockReplicationSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	virtual void Deinitialize() override;
+
+	// Null in standalone games, and on clients until it's replicated
+	AQulockReplicationInfo* GetReplicationInfo() const;
+
+	void SetReplicationInfo(AQulockReplicationInfo* NewReplicationInfo);
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type const WorldType) const override;
+
+private:
+	UPROPERTY()
+	AQulockReplicationInfo* ReplicationInfo = nullptr;
+
+};
@@ -0,0 +1,128 @@
+// Ricardo Santos, 2023
+
+#include "Subsystem/SaveGameSubsystem.h"
+
+#include <Async/TaskGraphInterfaces.h>
+#include <Kismet/GameplayStatics.h>
+
+#include "GameFramework/MXFPSGameModeBase.h"
+
+namespace
+{
+#if (UE_BUILD_DEBUG || UE_BUILD_DEVELOPMENT)
+	FName const SaveGameName = TEXT("MXFPSSaveGame_Debug");
+#else
+	FName const SaveGameName = TEXT("MXFPSSaveGame_0");
+#endif
+	
+	FName const UnknownSaveGameName = TEXT("SaveGame_Unknown");
+}
+
+void USaveGameSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UGameplayStatics::AsyncLoadGameFromSlot(SaveGameName.ToString(), 0,
+		FAsyncLoadGameFromSlotDelegate::CreateUObject(this, &USaveGameSubsystem::HandleSaveGameLoaded));
+}
+
+void USaveGameSubsystem::Deinitialize()
+{
+	// The store in flight completes on the game thread, so it's pumped until then, instead of racing it to the same file;
+	// it starts the next store as usual if anything was requested since, so this only returns once that one is done too.
+	while (bIsStoreInFlight)
+	{
+		FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+		FPlatformProcess::Sleep(0.f);
+	}
+
+	// There's no frame left to wait for an async store, whatever was requested last has to make it to disk now
+	if (SaveGameData && bIsStoreRequested)
+	{
+		UGameplayStatics::SaveGameToSlot(SaveGameData, SaveGameName.ToString(), 0);
+	}
+
+	OnSaveGameLoaded.Clear();
+	bIsStoreRequested = false;
+
+	Super::Deinitialize();
+}
+
+bool USaveGameSubsystem::IsSaveGameLoaded() const
+{
+	return SaveGameData != nullptr;
+}
+
+UMXFPSSaveGameData* USaveGameSubsystem::GetSaveGameData() const
+{
+	return SaveGameData;
+}
+
+void USaveGameSubsystem::CallWhenSaveGameLoaded(FSaveGameLoadedEvent::FDelegate&& Delegate)
+{
+	if (SaveGameData)
+	{
+		Delegate.ExecuteIfBound(SaveGameData);
+	}
+	else
+	{
+		OnSaveGameLoaded.Add(MoveTemp(Delegate));
+	}
+}
+
+void USaveGameSubsystem::RequestStore()
+{
+	bIsStoreRequested = true;
+
+	if (SaveGameData && !bIsStoreInFlight)
+	{
+		StartStore();
+	}
+}
+
+void USaveGameSubsystem::HandleSaveGameLoaded(FString const& SlotName, int32 const UserIndex, USaveGame* SaveGame)
+{
+	if (SaveGame)
+	{
+		SaveGameData = Cast<UMXFPSSaveGameData>(SaveGame);
+
+		if (!ensureMsgf(SaveGameData, TEXT("SaveGame exists but has unknown class type!")))
+		{
+			UGameplayStatics::AsyncSaveGameToSlot(SaveGame, UnknownSaveGameName.ToString(), 0);
+		}
+	}
+
+	if (!SaveGameData)
+	{
+		SaveGameData = NewObject<UMXFPSSaveGameData>(this, SaveGameName);
+	}
+
+	OnSaveGameLoaded.Broadcast(SaveGameData);
+	OnSaveGameLoaded.Clear();
+
+	// Someone might have asked to store it before it was even loaded
+	if (bIsStoreRequested)
+	{
+		StartStore();
+	}
+}
+
+void USaveGameSubsystem::HandleSaveGameStored(FString const& SlotName, int32 const UserIndex, bool bSuccess)
+{
+	bIsStoreInFlight = false;
+
+	if (bIsStoreRequested)
+	{
+		StartStore();
+	}
+}
+
+void USaveGameSubsystem::StartStore()
+{
+	// The data is serialized right away, so any change made after this needs another store
+	bIsStoreRequested = false;
+	bIsStoreInFlight = true;
+
+	UGameplayStatics::AsyncSaveGameToSlot(SaveGameData, SaveGameName.ToString(), 0,
+		FAsyncSaveGameToSlotDelegate::CreateUObject(this, &USaveGameSubsystem::HandleSaveGameStored));
+}
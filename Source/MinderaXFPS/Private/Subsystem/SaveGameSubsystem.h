@@ -0,0 +1,50 @@
+// Ricardo Santos, 2023
+
+#pragma once
+
+#include <CoreMinimal.h>
+#include <Subsystems/GameInstanceSubsystem.h>
+
+#include "SaveGameSubsystem.generated.h"
+
+class USaveGame;
+class UMXFPSSaveGameData;
+
+// Owns the SaveGame data for the whole game instance; it starts loading asynchronously as soon as the game boots,
+// so it's usually ready by the time the first level begins play.
+// Stores are asynchronous too, and coalesced: while one is in flight, any number of requests result in a single store after it.
+UCLASS()
+class USaveGameSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	bool IsSaveGameLoaded() const;
+
+	// Null until loaded
+	UMXFPSSaveGameData* GetSaveGameData() const;
+
+	DECLARE_MULTICAST_DELEGATE_OneParam(FSaveGameLoadedEvent, UMXFPSSaveGameData*);
+	FSaveGameLoadedEvent OnSaveGameLoaded;
+
+	// Calls the delegate right away if the data is already loaded, otherwise once it is
+	void CallWhenSaveGameLoaded(FSaveGameLoadedEvent::FDelegate&& Delegate);
+
+	void RequestStore();
+
+private:
+	void HandleSaveGameLoaded(FString const& SlotName, int32 const UserIndex, USaveGame* SaveGame);
+	void HandleSaveGameStored(FString const& SlotName, int32 const UserIndex, bool bSuccess);
+
+	void StartStore();
+
+	UPROPERTY()
+	UMXFPSSaveGameData* SaveGameData = nullptr;
+
+	bool bIsStoreInFlight = false;
+	bool bIsStoreRequested = false;
+
+};
@@ -0,0 +1,245 @@
+// Ricardo Santos, 2023
+
+#include "Subsystem/SpawnPointSubsystem.h"
+
+#include <Algo/BinarySearch.h>
+#include <NavMesh/RecastNavMesh.h>
+
+namespace
+{
+	// Enough for a few hundred enemies to be spread out, while keeping the pool cheap to filter
+	constexpr int32 MaxSpawnPoints = 1024;
+
+	// Consecutive candidates rejected for being too close to another point, before we consider the level full
+	constexpr int32 MaxRejectedCandidates = 256;
+
+	FIntVector GetCell(FVector const& Location, double CellSize)
+	{
+		return FIntVector(FMath::FloorToInt32(Location.X / CellSize),
+						  FMath::FloorToInt32(Location.Y / CellSize),
+						  FMath::FloorToInt32(Location.Z / CellSize));
+	}
+}
+
+void USpawnPointSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	RandomStream.GenerateNewSeed();
+	RandomSeed = RandomStream.GetInitialSeed();
+}
+
+void USpawnPointSubsystem::Deinitialize()
+{
+	PoolMap.Reset();
+	ActivePool = nullptr;
+	EligibleIndexArray.Reset();
+	AvailableIndexArray.Reset();
+
+	Super::Deinitialize();
+}
+
+void USpawnPointSubsystem::SetRandomSeed(int32 const Seed)
+{
+	RandomStream.Initialize(Seed);
+	RandomSeed = Seed;
+
+	// Start handing out points over, so the same seed always yields the same sequence
+	AvailableIndexArray = EligibleIndexArray;
+}
+
+void USpawnPointSubsystem::BuildSpawnPointPool(UWorld const* World, ARecastNavMesh const* NavMesh, FVector const& Origin, float Radius, float Spacing)
+{
+	if (!World || !NavMesh)
+	{
+		return;
+	}
+
+	FSpawnPointPool& Pool = PoolMap.FindOrAdd(World->GetPackage()->GetFName());
+	if (Pool.PointArray.IsEmpty() || !Pool.Origin.Equals(Origin) || Pool.Radius != Radius || Pool.Spacing != Spacing || Pool.Seed != RandomSeed)
+	{
+		Pool.Origin = Origin;
+		Pool.Radius = Radius;
+		Pool.Spacing = Spacing;
+		Pool.Seed = RandomSeed;
+
+		SampleSpawnPoints(NavMesh, Pool);
+	}
+
+	// The map might have been reloaded, nothing was handed out in it yet
+	ActivePool = &Pool;
+	ResetSafeArea();
+}
+
+void USpawnPointSubsystem::SetSafeArea(FVector const& Location, float Radius)
+{
+	ResetSafeArea();
+
+	if (!ActivePool)
+	{
+		return;
+	}
+
+	double const RadiusSquared = FMath::Square(Radius);
+	EligibleIndexArray.RemoveAllSwap([this, &Location, RadiusSquared](int32 const Index)
+	{
+		return FVector::DistSquared(ActivePool->PointArray[Index], Location) < RadiusSquared;
+	});
+
+	AvailableIndexArray = EligibleIndexArray;
+}
+
+bool USpawnPointSubsystem::TakeSpawnPoint(FVector& OutLocation)
+{
+	if (!ActivePool || AvailableIndexArray.IsEmpty())
+	{
+		// Handing out a used point again would put two enemies on top of each other
+		ensureMsgf(!ActivePool || EligibleIndexArray.IsEmpty(), TEXT("All %d spawn points outside the safe area were taken, either lower the enemy count or the spacing."), EligibleIndexArray.Num());
+		return false;
+	}
+
+	int32 const AvailableIndex = RandomStream.RandHelper(AvailableIndexArray.Num());
+	OutLocation = ActivePool->PointArray[AvailableIndexArray[AvailableIndex]];
+	AvailableIndexArray.RemoveAtSwap(AvailableIndex, 1, false);
+	return true;
+}
+
+bool USpawnPointSubsystem::GetRandomSpawnPoint(FVector& OutLocation) const
+{
+	if (!ActivePool || ActivePool->PointArray.IsEmpty())
+	{
+		return false;
+	}
+
+	OutLocation = ActivePool->PointArray[RandomStream.RandHelper(ActivePool->PointArray.Num())];
+	return true;
+}
+
+float USpawnPointSubsystem::GetRandomYaw() const
+{
+	return RandomStream.FRandRange(0.f, 360.f);
+}
+
+int32 USpawnPointSubsystem::GetNumSpawnPoints() const
+{
+	return ActivePool ? ActivePool->PointArray.Num() : 0;
+}
+
+void USpawnPointSubsystem::SampleSpawnPoints(ARecastNavMesh const* NavMesh, FSpawnPointPool& Pool) const
+{
+	Pool.PointArray.Reset();
+
+	// The navmesh's own random points go through FMath, so we pick ours from the reachable polys, with a seeded stream,
+	// uniformly by area; each poly is a convex fan of triangles, which are what we actually pick from.
+	TArray<NavNodeRef> PolyArray;
+	if (!NavMesh->GetPolysWithinPathingDistance(Pool.Origin, Pool.Radius, PolyArray))
+	{
+		return;
+	}
+
+	TArray<FVector> TriangleVertexArray;
+	TArray<double> CumulativeAreaArray;
+	TArray<FVector> PolyVertexArray;
+	for (NavNodeRef const Poly : PolyArray)
+	{
+		if (!NavMesh->GetPolyVerts(Poly, PolyVertexArray))
+		{
+			continue;
+		}
+
+		for (int32 Index = 2; Index < PolyVertexArray.Num(); ++Index)
+		{
+			FVector const& A = PolyVertexArray[0];
+			FVector const& B = PolyVertexArray[Index - 1];
+			FVector const& C = PolyVertexArray[Index];
+
+			double const Area = 0.5 * FVector::CrossProduct(B - A, C - A).Size();
+			if (Area > UE_DOUBLE_SMALL_NUMBER)
+			{
+				TriangleVertexArray.Append({ A, B, C });
+				CumulativeAreaArray.Add((CumulativeAreaArray.IsEmpty() ? 0.0 : CumulativeAreaArray.Last()) + Area);
+			}
+		}
+	}
+
+	if (CumulativeAreaArray.IsEmpty())
+	{
+		return;
+	}
+
+	// Seeded for this pool alone, so it's the same whenever it's built with the same seed, and doesn't consume the points' stream
+	FRandomStream SampleStream{ Pool.Seed };
+
+	// Dart throwing, with a grid whose cells are as big as the spacing, so only the neighboring cells need to be checked
+	double const Spacing = FMath::Max(static_cast<double>(Pool.Spacing), 1.0);
+	double const SpacingSquared = FMath::Square(Spacing);
+	TMap<FIntVector, TArray<int32, TInlineAllocator<4>>> CellMap;
+
+	int32 NumRejectedCandidates = 0;
+	while (Pool.PointArray.Num() < MaxSpawnPoints && NumRejectedCandidates < MaxRejectedCandidates)
+	{
+		double const AreaSample = SampleStream.GetFraction() * CumulativeAreaArray.Last();
+		int32 const Triangle = FMath::Min(Algo::UpperBound(CumulativeAreaArray, AreaSample), CumulativeAreaArray.Num() - 1);
+
+		// Folding the square onto the triangle keeps it uniform
+		double U = SampleStream.GetFraction();
+		double V = SampleStream.GetFraction();
+		if (U + V > 1.0)
+		{
+			U = 1.0 - U;
+			V = 1.0 - V;
+		}
+
+		FVector const& A = TriangleVertexArray[Triangle * 3];
+		FVector const Candidate = A + (TriangleVertexArray[Triangle * 3 + 1] - A) * U + (TriangleVertexArray[Triangle * 3 + 2] - A) * V;
+
+		FIntVector const Cell = GetCell(Candidate, Spacing);
+
+		bool bIsTooClose = false;
+		for (int32 X = -1; X <= 1 && !bIsTooClose; ++X)
+		{
+			for (int32 Y = -1; Y <= 1 && !bIsTooClose; ++Y)
+			{
+				for (int32 Z = -1; Z <= 1 && !bIsTooClose; ++Z)
+				{
+					if (auto const* CellIndexArrayPtr = CellMap.Find(Cell + FIntVector(X, Y, Z)))
+					{
+						for (int32 const Index : *CellIndexArrayPtr)
+						{
+							if (FVector::DistSquared(Pool.PointArray[Index], Candidate) < SpacingSquared)
+							{
+								bIsTooClose = true;
+								break;
+							}
+						}
+					}
+				}
+			}
+		}
+
+		if (bIsTooClose)
+		{
+			++NumRejectedCandidates;
+			continue;
+		}
+
+		NumRejectedCandidates = 0;
+		CellMap.FindOrAdd(Cell).Add(Pool.PointArray.Add(Candidate));
+	}
+}
+
+void USpawnPointSubsystem::ResetSafeArea()
+{
+	EligibleIndexArray.Reset();
+	AvailableIndexArray.Reset();
+
+	if (ActivePool)
+	{
+		for (int32 Index = 0; Index < ActivePool->PointArray.Num(); ++Index)
+		{
+			EligibleIndexArray.Add(Index);
+		}
+
+		AvailableIndexArray = EligibleIndexArray;
+	}
+}
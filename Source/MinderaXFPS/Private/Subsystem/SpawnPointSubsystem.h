@@ -0,0 +1,69 @@
+// Ricardo Santos, 2023
+
+#pragma once
+
+#include <CoreMinimal.h>
+#include <Subsystems/GameInstanceSubsystem.h>
+
+#include "SpawnPointSubsystem.generated.h"
+
+class ARecastNavMesh;
+
+// Pool of reachable navmesh points, Poisson-disk distributed, i.e., no two of them closer than a given spacing.
+// Built once per map and kept for as long as the game instance, so restarting the level doesn't sample it again;
+// points within the safe area are filtered once whenever it changes, so each point handed out after that is O(1).
+UCLASS()
+class USpawnPointSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// For reproducible runs, the order points are handed out in, and the pools they're handed out from, only depend on the seed
+	void SetRandomSeed(int32 Seed);
+
+	// Does nothing if the pool for the world's map was already built with the same parameters and seed
+	void BuildSpawnPointPool(UWorld const* World, ARecastNavMesh const* NavMesh, FVector const& Origin, float Radius, float Spacing);
+
+	// Points within the radius of the location aren't handed out by TakeSpawnPoint, until the safe area changes
+	void SetSafeArea(FVector const& Location, float Radius);
+
+	// Hands out every point outside the safe area once, in random order, so no two takers ever get closer than the spacing.
+	// Fails once they're all taken, until the safe area or the seed changes, which starts handing them out over.
+	bool TakeSpawnPoint(FVector& OutLocation);
+
+	// Any point in the pool, regardless of the safe area
+	bool GetRandomSpawnPoint(FVector& OutLocation) const;
+
+	// In degrees, from the same stream as the points, so it depends on the seed too
+	float GetRandomYaw() const;
+
+	int32 GetNumSpawnPoints() const;
+
+private:
+	struct FSpawnPointPool
+	{
+		FVector Origin;
+		float Radius = 0.f;
+		float Spacing = 0.f;
+		int32 Seed = 0;
+		TArray<FVector> PointArray;
+	};
+
+	void SampleSpawnPoints(ARecastNavMesh const* NavMesh, FSpawnPointPool& Pool) const;
+
+	void ResetSafeArea();
+
+	TMap<FName, FSpawnPointPool> PoolMap;
+	FSpawnPointPool const* ActivePool = nullptr;
+
+	TArray<int32> EligibleIndexArray;
+	TArray<int32> AvailableIndexArray;
+
+	// Only hands out points, pools are sampled from a stream of their own, so every run consumes this one the same way
+	mutable FRandomStream RandomStream;
+	int32 RandomSeed = 0;
+
+};
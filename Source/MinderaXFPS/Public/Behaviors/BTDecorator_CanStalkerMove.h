@@ -0,0 +1,38 @@
+// Ricardo Santos, 2023
+
+#pragma once
+
+#include <CoreMinimal.h>
+#include <BehaviorTree/BTDecorator.h>
+
+#include "BTDecorator_CanStalkerMove.generated.h"
+
+// Native BTD_CanStalkerMove: passes while the stalker can move, according to its Qulock component.
+// Instead of being checked every tick, it listens to the controller's can-move changes while relevant,
+// and requests the observer abort as soon as the stalker freezes or unfreezes.
+UCLASS(meta = (DisplayName = "Can Stalker Move"))
+class MINDERAXFPS_API UBTDecorator_CanStalkerMove : public UBTDecorator
+{
+	GENERATED_BODY()
+
+public:
+	explicit UBTDecorator_CanStalkerMove(FObjectInitializer const& ObjectInitializer);
+
+	virtual bool CalculateRawConditionValue(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) const override;
+
+	virtual uint16 GetInstanceMemorySize() const override;
+
+protected:
+	virtual void OnBecomeRelevant(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+
+	virtual void OnCeaseRelevant(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+
+private:
+	struct FCanStalkerMoveMemory
+	{
+		FDelegateHandle CanMoveChangedHandle;
+	};
+
+	void HandleCanMoveChanged(bool bCanMove, TWeakObjectPtr<UBehaviorTreeComponent> OwnerComp) const;
+
+};
@@ -0,0 +1,37 @@
+// Ricardo Santos, 2023
+
+#pragma once
+
+#include <CoreMinimal.h>
+#include <BehaviorTree/BTDecorator.h>
+
+#include "BTDecorator_ShouldRunBehaviors.generated.h"
+
+// Native BTD_ShouldRunBehaviors: passes while the game is running, i.e., started, not over and not paused.
+// Listens to the game mode's state changes while relevant, instead of checking it every tick.
+UCLASS(meta = (DisplayName = "Should Run Behaviors"))
+class MINDERAXFPS_API UBTDecorator_ShouldRunBehaviors : public UBTDecorator
+{
+	GENERATED_BODY()
+
+public:
+	explicit UBTDecorator_ShouldRunBehaviors(FObjectInitializer const& ObjectInitializer);
+
+	virtual bool CalculateRawConditionValue(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) const override;
+
+	virtual uint16 GetInstanceMemorySize() const override;
+
+protected:
+	virtual void OnBecomeRelevant(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+
+	virtual void OnCeaseRelevant(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+
+private:
+	struct FShouldRunBehaviorsMemory
+	{
+		FDelegateHandle GameRunningChangedHandle;
+	};
+
+	void HandleGameRunningChanged(bool bIsGameRunning, TWeakObjectPtr<UBehaviorTreeComponent> OwnerComp) const;
+
+};
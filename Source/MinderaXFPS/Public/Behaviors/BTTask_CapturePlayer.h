@@ -0,0 +1,25 @@
+// Ricardo Santos, 2023
+
+#pragma once
+
+#include <CoreMinimal.h>
+#include <BehaviorTree/BTTaskNode.h>
+
+#include "BTTask_CapturePlayer.generated.h"
+
+// Native BTT_CapturePlayer: ends the game, with the stalker's controller as the one responsible for it
+UCLASS(meta = (DisplayName = "Capture Player"))
+class MINDERAXFPS_API UBTTask_CapturePlayer : public UBTTaskNode
+{
+	GENERATED_BODY()
+
+public:
+	explicit UBTTask_CapturePlayer(FObjectInitializer const& ObjectInitializer);
+
+	virtual EBTNodeResult::Type ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+
+protected:
+	UPROPERTY(EditAnywhere, Category = "Stalker")
+	bool bShouldRestartGame = false;
+
+};
@@ -0,0 +1,38 @@
+// Ricardo Santos, 2023
+
+#pragma once
+
+#include <CoreMinimal.h>
+#include <BehaviorTree/Tasks/BTTask_BlackboardBase.h>
+
+#include "BTTask_FindPlayer.generated.h"
+
+// Native BTT_FindPlayer: stores the closest player pawn in the blackboard key.
+// When following the flow field, it keeps running until the stalker gets close enough to the player,
+// and the stalker stops following as soon as the task finishes or is aborted.
+UCLASS(meta = (DisplayName = "Find Player"))
+class MINDERAXFPS_API UBTTask_FindPlayer : public UBTTask_BlackboardBase
+{
+	GENERATED_BODY()
+
+public:
+	explicit UBTTask_FindPlayer(FObjectInitializer const& ObjectInitializer);
+
+	virtual EBTNodeResult::Type ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+
+protected:
+	virtual EBTNodeResult::Type AbortTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+
+	virtual void TickTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds) override;
+
+	virtual void OnTaskFinished(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTNodeResult::Type TaskResult) override;
+
+	// Whether the stalker also starts following the flow field towards the player, instead of relying on a MoveTo
+	UPROPERTY(EditAnywhere, Category = "Stalker")
+	bool bShouldFollowFlowField = false;
+
+	// How close to the player the stalker has to get for the task to succeed, when following the flow field
+	UPROPERTY(EditAnywhere, Category = "Stalker", meta = (EditCondition = "bShouldFollowFlowField", ClampMin = "0"))
+	float AcceptanceRadius = 100.f;
+
+};
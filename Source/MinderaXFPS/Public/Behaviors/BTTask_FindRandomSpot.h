@@ -0,0 +1,26 @@
+// Ricardo Santos, 2023
+
+#pragma once
+
+#include <CoreMinimal.h>
+#include <BehaviorTree/Tasks/BTTask_BlackboardBase.h>
+
+#include "BTTask_FindRandomSpot.generated.h"
+
+// Native BTT_FindRandomSpot: stores a random point, reachable from the pawn through the navmesh, in the blackboard key
+UCLASS(meta = (DisplayName = "Find Random Spot"))
+class MINDERAXFPS_API UBTTask_FindRandomSpot : public UBTTask_BlackboardBase
+{
+	GENERATED_BODY()
+
+public:
+	explicit UBTTask_FindRandomSpot(FObjectInitializer const& ObjectInitializer);
+
+	virtual EBTNodeResult::Type ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+
+protected:
+	// How far from the pawn the spot may be
+	UPROPERTY(EditAnywhere, Category = "Wanderer", meta = (ClampMin = "0"))
+	float SearchRadius = 2000.f;
+
+};
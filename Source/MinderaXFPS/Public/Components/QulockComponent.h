@@ -4,9 +4,50 @@
 
 #include <CoreMinimal.h>
 #include <Components/ActorComponent.h>
+#include <Containers/StaticArray.h>
+#include <ProfilingDebugging/CsvProfiler.h>
 
 #include "QulockComponent.generated.h"
 
+namespace QulockFrameCapture
+{
+	struct FCapturedEvaluation;
+}
+
+DECLARE_STATS_GROUP(TEXT("Qulock Movement Logic"), STATGROUP_QulockMovement, STATCAT_Advanced);
+
+// Per-frame timings and counts, for CSV captures (e.g., the ones made by AMXFPSBenchmarkGameMode)
+CSV_DECLARE_CATEGORY_EXTERN(Qulock);
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FQulockCanMoveChangedEvent, bool, bCanMove);
+
+// Same responses as ECC_Visibility (see DefaultEngine.ini), except for the actors that Qulock components ignore,
+// which are made to ignore it at runtime, whatever their preset
+#define ECC_QulockVisibility ECC_GameTraceChannel2
+
+// A single visibility trace, from the player view's origin to one of the support vertexes of the target;
+// if the end of the trace lies outside the view frustum, ProjectedEnd holds the point projected back into it.
+struct FQulockViewTrace
+{
+	FVector Start;
+	FVector End;
+	FVector ProjectedEnd;
+	bool bShouldProject = false;
+};
+
+// Last time an actor was in a player's view, along with what it depended on
+struct FQulockVisibilityCacheEntry
+{
+	TWeakObjectPtr<AActor> Actor;
+	FVector ViewOrigin;
+	FVector ViewForwardDir;
+	FVector ViewUpDir;
+	FVector ActorLocation;
+	FQuat ActorRotation;
+	uint32 OccluderEpoch = 0;
+	double EvaluatedTime = 0.0;
+};
+
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class MINDERAXFPS_API UQulockComponent : public UActorComponent
 {
@@ -17,12 +58,28 @@ public:
 
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(EEndPlayReason::Type const EndPlayReason) override;
+
+	// Inactive components are neither evaluated nor replicated, e.g., while their target is pooled
+	virtual void Activate(bool bReset = false) override;
+	virtual void Deactivate() override;
+
 	UFUNCTION(BlueprintCallable)
 	void SetupPlayerToCheck(APlayerController* PlayerController);
 
 	UFUNCTION(BlueprintPure)
 	bool CanMoveThisFrame() const;
 
+	// Broadcast once per frame at most, by the evaluation subsystem, whenever the result of CanMoveThisFrame changes
+	UPROPERTY(BlueprintAssignable)
+	FQulockCanMoveChangedEvent OnCanMoveChanged;
+
+	// Last value broadcast by OnCanMoveChanged
+	UFUNCTION(BlueprintPure)
+	bool CanMove() const;
+
+	void PublishCanMove();
+
 	UFUNCTION(BlueprintPure)
 	bool IsActorWithinPlayerView(APlayerController* Player, AActor* Actor) const; 
 
@@ -30,26 +87,121 @@ public:
 	bool IsActorWithinPlayerFrustum(APlayerController* Player, AActor* Actor,
 									TArray<FVector>& OutSupportVertexes) const;
 	
+	// Players whose frustum the target's bounds might be within, according to the broad phase
+	void GetPlayersWithinBroadPhase(TArray<APlayerController*, TInlineAllocator<4>>& OutPlayerArray) const;
+	
+	// Only results where the actor was in view are ever reused, anything else might have changed enough to see it by now
+	bool IsCachedInView(APlayerController* Player, AActor* Actor) const;
+	void CacheVisibilityResult(APlayerController* Player, AActor* Actor, bool bIsInView) const;
+
+	// Computes the traces that IsActorWithinPlayerView would execute, without executing them;
+	// OutCapturedEvaluation, if any, gets everything but the traces and the result, which aren't known yet.
+	bool ComputePlayerViewTraces(APlayerController* Player, AActor* Actor, TArray<FQulockViewTrace>& OutViewTraces,
+								 QulockFrameCapture::FCapturedEvaluation* OutCapturedEvaluation = nullptr) const;
+
 	UFUNCTION(BlueprintPure)
 	FMatrix GetPlayerViewProjMatrix(APlayerController* Player) const;
 
 	UFUNCTION(BlueprintPure)
 	FVector GetPlayerViewOrigin(APlayerController* Player) const;
 
+	AActor* GetTraceTarget() const;
+
+	FCollisionQueryParams const& GetTraceParams() const;
+
+	ECollisionChannel GetTraceChannel() const;
+
+	// Whether a trace that doesn't hit anything still sees the target, which happens when the target itself is ignored
+	bool DoesTraceMissSeeTarget() const;
+
+	TSet<APlayerController*> const& GetPlayerControllerSet() const;
+
+	bool ShouldUseBatchedEvaluation() const;
+
 protected:
+	// Only in standalone games, see bCheckAllConnectedPlayers
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Qulock")
 	TSet<TEnumAsByte<EAutoReceiveInput::Type>> PlayersToCheck;
 
+	// Whether a server checks the view of every connected player, including the ones that join later, instead of PlayersToCheck;
+	// clients never evaluate anything, they get whether each target is frozen from the server (see AQulockReplicationInfo).
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Qulock|Network")
+	bool bCheckAllConnectedPlayers = true;
+
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Qulock")
 	TSet<TSubclassOf<AActor>> ActorsToIgnore;
+
+	// Whether the actors to ignore are excluded by making them ignore ECC_QulockVisibility, and tracing on it,
+	// instead of adding each of them to the ignore list of every trace; this includes the target itself, if it's one of them,
+	// so a trace that reaches the target's bounds without hitting anything sees it.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Qulock")
+	bool bUseIgnoredActorsTraceChannel = true;
+
+	// Whether the traces are batched with every other Qulock target and executed asynchronously;
+	// results are one frame late, but targets are conservatively considered observed until they arrive.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Qulock")
+	bool bUseBatchedEvaluation = true;
+
+	// Whether occlusion is tested against a software depth buffer of the registered Qulock occluders,
+	// instead of tracing against the whole collision scene; there are no traces left to batch in this mode.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Qulock")
+	bool bUseOcclusionBuffer = false;
+
+	// Whether the actor is still considered in view of a player that saw it last time, while neither the view,
+	// the target, nor the occluders moved much; a result where it wasn't in view is never reused.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Qulock|Visibility Cache")
+	bool bUseVisibilityCache = true;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Qulock|Visibility Cache", meta = (EditCondition = "bUseVisibilityCache", ClampMin = "0"))
+	float ViewOriginThreshold = 1.f;
+
+	// In degrees
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Qulock|Visibility Cache", meta = (EditCondition = "bUseVisibilityCache", ClampMin = "0"))
+	float ViewRotationThreshold = 0.1f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Qulock|Visibility Cache", meta = (EditCondition = "bUseVisibilityCache", ClampMin = "0"))
+	float TargetLocationThreshold = 1.f;
+
+	// In degrees
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Qulock|Visibility Cache", meta = (EditCondition = "bUseVisibilityCache", ClampMin = "0"))
+	float TargetRotationThreshold = 0.5f;
+
+	// Results older than this are never reused, to bound how long we can miss an unregistered occluder moving
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Qulock|Visibility Cache", meta = (EditCondition = "bUseVisibilityCache", ClampMin = "0"))
+	float MaxCachedResultAge = 0.5f;
 	
 private:
+	bool EvaluateActorWithinPlayerView(APlayerController* Player, AActor* Actor) const;
+
+	bool CanReuseVisibilityResult(FQulockVisibilityCacheEntry const& CacheEntry, struct FPlayerViewData const& PlayerViewData,
+								  AActor* Actor, uint32 OccluderEpoch, double Time) const;
+
 	void UpdateTraceParams(AActor* TargetActor);
+
+	void CacheTargetBounds(AActor* TargetActor);
+
+	TStaticArray<FVector, 8> GetActorBoundsVertexes(AActor* Actor) const;
 	
 	class UPlayerViewDataCachingSubsystem* GetCachingSubsystem() const;
 
+	class UQulockEvaluationSubsystem* GetEvaluationSubsystem() const;
+
+	class UQulockOcclusionSubsystem* GetOcclusionSubsystem() const;
+
+	class UQulockBroadPhaseSubsystem* GetBroadPhaseSubsystem() const;
+
+	class UQulockReplicationSubsystem* GetReplicationSubsystem() const;
+
 	UFUNCTION()
 	void HandleTraceTargetChanged(APawn* OldPawn, APawn* NewPawn);
+
+	void HandleEnemyActivated(APawn* Enemy);
+
+	void HandlePostLogin(class AGameModeBase* GameMode, APlayerController* NewPlayer);
+	void HandleLogout(AGameModeBase* GameMode, AController* Exiting);
+
+	void HandleTargetTransformUpdated(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags,
+									  ETeleportType Teleport);
 	
 	UPROPERTY()
 	TSet<APlayerController*> PlayerControllerSet;
@@ -57,9 +209,38 @@ private:
 	UPROPERTY()
 	mutable UPlayerViewDataCachingSubsystem* CachingSubsystem = nullptr;
 
+	UPROPERTY()
+	mutable UQulockEvaluationSubsystem* EvaluationSubsystem = nullptr;
+
+	UPROPERTY()
+	mutable UQulockOcclusionSubsystem* OcclusionSubsystem = nullptr;
+
+	UPROPERTY()
+	mutable UQulockBroadPhaseSubsystem* BroadPhaseSubsystem = nullptr;
+
+	UPROPERTY()
+	mutable UQulockReplicationSubsystem* ReplicationSubsystem = nullptr;
+
 	TWeakObjectPtr<AActor> TraceTarget;
 	FCollisionQueryParams TraceParams;
 
+	// Oriented bounds of the trace target, computed once in its local space,
+	// and only transformed into world space when the target actually moves.
+	FBox TargetLocalBounds;
+	TStaticArray<FVector, 8> TargetBoundsVertexes;
+	TWeakObjectPtr<USceneComponent> TargetRootComponent;
+	FDelegateHandle TargetTransformUpdatedHandle;
+
+	FDelegateHandle PostLoginHandle;
+	FDelegateHandle LogoutHandle;
+	FDelegateHandle EnemyActivatedHandle;
+
+	mutable TMap<APlayerController*, FQulockVisibilityCacheEntry> VisibilityCacheMap;
+
+	// Whoever saw the target last is the likeliest to see it again, so they're evaluated first
+	mutable TWeakObjectPtr<APlayerController> LastObservingPlayer;
+
 	TFrameValue<FTimerHandle> TraceParamsUpdateHandle;
 	mutable TFrameValue<bool> bCachedCanMoveThisFrame;
+	bool bPublishedCanMove = false;
 };
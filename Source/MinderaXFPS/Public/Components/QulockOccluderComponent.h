@@ -0,0 +1,36 @@
+// Ricardo Santos, 2023
+
+#pragma once
+
+#include <CoreMinimal.h>
+#include <Components/ActorComponent.h>
+
+#include "QulockOccluderComponent.generated.h"
+
+// Registers boxes of its owner as occluders for Qulock targets that use the occlusion buffer;
+// the boxes are authored rather than taken from the bounds of the geometry, since bounds cover gaps like doorways and windows,
+// and anything they cover that can actually be seen through would be considered unobserved.
+UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
+class MINDERAXFPS_API UQulockOccluderComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UQulockOccluderComponent(FObjectInitializer const& ObjectInitializer);
+
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(EEndPlayReason::Type const EndPlayReason) override;
+
+	// In the space of the owner's root component, and each entirely inside solid geometry; boxes without volume are ignored
+	UPROPERTY(EditAnywhere, Category = "Qulock")
+	TArray<FBox> OccluderBoxArray;
+
+private:
+	void HandleOwnerTransformUpdated(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags,
+									 ETeleportType TeleportType);
+
+	TWeakObjectPtr<USceneComponent> OwnerRootComponent;
+	FDelegateHandle OwnerTransformUpdatedHandle;
+
+};
@@ -7,6 +7,9 @@
 
 #include "StalkerAIController.generated.h"
 
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FStalkerCanMoveChangedEvent, bool, bCanMove);
+DECLARE_MULTICAST_DELEGATE_OneParam(FStalkerCanMoveChangedNativeEvent, bool /* bCanMove */);
+
 UCLASS()
 class MINDERAXFPS_API AStalkerAIController : public AAIController
 {
@@ -15,7 +18,13 @@ class MINDERAXFPS_API AStalkerAIController : public AAIController
 public:
 	explicit AStalkerAIController(FObjectInitializer const& ObjectInitializer);
 
-	virtual void Tick(float DeltaSeconds) override;
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(EEndPlayReason::Type const EndPlayReason) override;
+
+	virtual void OnPossess(APawn* InPawn) override;
+
+	virtual void OnUnPossess() override;
 
 	UFUNCTION(BlueprintImplementableEvent, Category = "Stalker")
 	void OnMoveToInterrupted();
@@ -28,6 +37,24 @@ public:
 
 	UFUNCTION(BlueprintPure, Category = "Stalker")
 	bool CanExecuteMoveTo() const;
+
+	// Heads towards the goal through the flow field shared by every stalker with the same goal, instead of a MoveTo;
+	// the stalker keeps following it, whenever it can move, until stopped.
+	UFUNCTION(BlueprintCallable, Category = "Stalker")
+	void FollowFlowFieldTo(AActor* Goal);
+
+	UFUNCTION(BlueprintCallable, Category = "Stalker")
+	void StopFollowingFlowField();
+
+	UFUNCTION(BlueprintPure, Category = "Stalker")
+	bool IsFollowingFlowField() const;
+
+	// Lets behaviors (e.g. BTD_CanStalkerMove) react to the stalker freezing or unfreezing, instead of polling CanExecuteMoveTo
+	UPROPERTY(BlueprintAssignable, Category = "Stalker")
+	FStalkerCanMoveChangedEvent OnCanMoveChanged;
+
+	// Same as OnCanMoveChanged, for native behavior tree nodes, which can't bind to dynamic delegates without being instanced
+	FStalkerCanMoveChangedNativeEvent OnCanMoveChangedNative;
 	
 protected:
 	UPROPERTY(EditAnywhere, Category = "Stalker")
@@ -38,7 +65,37 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Stalker")
 	bool bShouldInterruptMoveTo = true;
 
+	// Whether movement, path following and animation stop ticking while the stalker can't move;
+	// they are resumed as soon as it can, and pick up exactly where they left off.
+	// Movement keeps ticking while the stalker is falling, so it doesn't hover, and is only suspended once it lands.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Stalker|Frozen")
+	bool bShouldSuspendWhenFrozen = true;
+
+	// If not zero, the mesh keeps ticking at this interval while frozen, instead of not ticking at all
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Stalker|Frozen", meta = (EditCondition = "bShouldSuspendWhenFrozen", ClampMin = "0"))
+	float FrozenMeshTickInterval = 0.f;
+
 private:
+	UFUNCTION()
+	void HandleCanMoveChanged(bool bCanMove);
+
+	void StopFlowFieldStep();
+
+	void SetPawnSuspended(APawn* TargetPawn, bool bSuspended);
+
+	UFUNCTION()
+	void HandlePawnLanded(FHitResult const& Hit);
+
+	class UFlowFieldNavigationSubsystem* GetFlowFieldSubsystem() const;
+	
 	bool bCachedCanMove;
+	bool bIsPawnSuspended = false;
+
+	// How the mesh ticked before it was suspended, so it's restored as it was, rather than forced on
+	bool bWasMeshTickEnabled = true;
+	float UnfrozenMeshTickInterval = 0.f;
+
+	UPROPERTY()
+	mutable UFlowFieldNavigationSubsystem* FlowFieldSubsystem = nullptr;
 	
 };
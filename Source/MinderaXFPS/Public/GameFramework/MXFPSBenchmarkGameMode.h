@@ -0,0 +1,101 @@
+// Ricardo Santos, 2023
+
+#pragma once
+
+#include <CoreMinimal.h>
+
+#include "GameFramework/MXFPSGameModeBase.h"
+
+#include "MXFPSBenchmarkGameMode.generated.h"
+
+// Plays a map unattended with a scripted camera path, once per enemy count, and records a CSV profiler capture of each run,
+// so the cost of the Qulock evaluation, the flow fields and the spawner can be compared across changes, e.g.:
+//   MinderaXFPS LBP_FixedLayoutMap?game=/Script/MinderaXFPS.MXFPSBenchmarkGameMode -benchmark -fps=60 -unattended -nullrhi
+// Runs are soft reset between enemy counts and seeded, so the spawn points and the camera path are the same every time.
+// The captures are written to Saved/Profiling/CSV, one per enemy count, and the game exits after the last one.
+UCLASS(Config = Game)
+class MINDERAXFPS_API AMXFPSBenchmarkGameMode : public AMXFPSGameModeBase
+{
+	GENERATED_BODY()
+
+public:
+	explicit AMXFPSBenchmarkGameMode(FObjectInitializer const& ObjectInitializer);
+
+	virtual void InitGame(FString const& MapName, FString const& Options, FString& ErrorMessage) override;
+
+	virtual void BeginPlay() override;
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	virtual void OnNotifyGameReady_Implementation() override;
+
+protected:
+	// Overridden by ?Seed=
+	UPROPERTY(Config, EditAnywhere, Category = "MXFPS|Benchmark")
+	int32 RandomSeed = 1337;
+
+	// One run per entry, in order
+	UPROPERTY(Config, EditAnywhere, Category = "MXFPS|Benchmark")
+	TArray<int32> EnemyCountArray;
+
+	// Frames played before recording, so that spawning and the first flow fields aren't part of the capture
+	UPROPERTY(Config, EditAnywhere, Category = "MXFPS|Benchmark", meta = (ClampMin = "0"))
+	int32 NumWarmupFrames = 120;
+
+	UPROPERTY(Config, EditAnywhere, Category = "MXFPS|Benchmark", meta = (ClampMin = "1"))
+	int32 NumRecordedFrames = 1800;
+
+	// Used when the game mode isn't a blueprint, i.e., when it's picked with ?game=
+	UPROPERTY(Config, EditAnywhere, Category = "MXFPS|Benchmark")
+	TSoftClassPtr<APawn> DefaultEnemyClass;
+
+	// The camera goes around a loop through this many spawn points
+	UPROPERTY(Config, EditAnywhere, Category = "MXFPS|Benchmark|Camera", meta = (ClampMin = "2"))
+	int32 NumCameraWaypoints = 8;
+
+	UPROPERTY(Config, EditAnywhere, Category = "MXFPS|Benchmark|Camera")
+	float CameraSpeed = 600.f;
+
+	UPROPERTY(Config, EditAnywhere, Category = "MXFPS|Benchmark|Camera")
+	float CameraHeight = 100.f;
+
+	// How fast the camera looks around while moving, in degrees/sec, so enemies keep going in and out of view
+	UPROPERTY(Config, EditAnywhere, Category = "MXFPS|Benchmark|Camera")
+	float CameraYawRate = 45.f;
+
+private:
+	enum class EBenchmarkPhase : uint8
+	{
+		Idle,
+		WarmingUp,
+		Recording,
+		Finishing,
+	};
+
+	void BuildCameraPath();
+	void MoveCamera(float DeltaSeconds);
+
+	void BeginRecording();
+	void EndRecording();
+
+	UFUNCTION()
+	void HandleGameOver();
+
+	TArray<FVector> CameraWaypointArray;
+	int32 CameraWaypointIndex = 0;
+	FVector CameraLocation = FVector::ZeroVector;
+	float CameraYaw = 0.f;
+
+	EBenchmarkPhase Phase = EBenchmarkPhase::Idle;
+	int32 EnemyCountIndex = 0;
+	int32 NumPhaseFrames = 0;
+
+	// Wall time of the recorded frames, for the summary in the log; the capture has the breakdown
+	double LastFrameTime = 0.0;
+	double TotalFrameTime = 0.0;
+	double MaxFrameTime = 0.0;
+
+	// Signaled once the last capture is written to disk, so we don't exit before that
+	FGraphEventRef CaptureWrittenEvent;
+
+};
@@ -27,6 +27,22 @@ public:
 	bool bIsFullscreen = true;
 };
 
+// What the game mode needs from a pawn to enable or disable it, gathered when it's registered, and whenever its controller changes
+USTRUCT()
+struct FMXFPSRegisteredPawn
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	APawn* Pawn = nullptr;
+
+	// Null if the pawn isn't a character
+	UPROPERTY()
+	class UCharacterMovementComponent* MovementComponent = nullptr;
+
+	bool bIsAIControlled = false;
+};
+
 UCLASS(Blueprintable)
 class MINDERAXFPS_API AMXFPSGameModeBase : public AGameModeBase
 {
@@ -39,8 +55,6 @@ public:
 
 	virtual void EndPlay(EEndPlayReason::Type const EndPlayReason) override;
 
-	virtual void Tick(float DeltaSeconds) override;
-
 	virtual AActor* ChoosePlayerStart_Implementation(AController* Player) override;
 	
 	UFUNCTION(BlueprintNativeEvent)
@@ -62,6 +76,26 @@ public:
 	UPROPERTY(BlueprintAssignable)
 	FGameStartEvent OnGamePaused;
 
+	// Broadcast along with any of the events above, with the new value of IsGameRunning
+	DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FGameRunningChangedEvent, bool, bIsGameRunning);
+	UPROPERTY(BlueprintAssignable)
+	FGameRunningChangedEvent OnGameRunningChanged;
+
+	// Same as OnGameRunningChanged, for native listeners
+	DECLARE_MULTICAST_DELEGATE_OneParam(FGameRunningChangedNativeEvent, bool /* bIsGameRunning */);
+	FGameRunningChangedNativeEvent OnGameRunningChangedNative;
+
+	// Broadcast whenever GetPlayerScore changes, i.e., once per second of game time while the game is running,
+	// so that widgets can update when it does instead of binding to it
+	DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FScoreChangedEvent, int32, NewPlayerScore);
+	UPROPERTY(BlueprintAssignable)
+	FScoreChangedEvent OnScoreChanged;
+
+	// Broadcast whenever HasNewHighscore changes, e.g., once when the score beats the highscore
+	DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FNewHighscoreChangedEvent, bool, bHasNewHighscore);
+	UPROPERTY(BlueprintAssignable)
+	FNewHighscoreChangedEvent OnNewHighscoreChanged;
+
 	UFUNCTION(BlueprintCallable)
 	void ExecuteGameStart();
 	
@@ -101,6 +135,9 @@ public:
 	UFUNCTION(BlueprintPure)
 	UMXFPSSaveGameData* GetSaveGameData() const;
 
+	// Every pawn in the world, kept up to date as they are spawned and destroyed, except for pooled enemies
+	TArray<FMXFPSRegisteredPawn> const& GetRegisteredPawns() const;
+
 protected:
 	UFUNCTION(BlueprintCallable)
 	void RestartGame();
@@ -114,6 +151,11 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MXFPS|Config", meta = (EditCondition = "bModifySaveGame"))
 	bool bUseSaveGame = false;
 	
+	// Whether RestartGame moves the player and the enemies back to spawn points, instead of reloading the level;
+	// enemies that aren't needed anymore are pooled, and reused when more are needed again.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MXFPS|Config")
+	bool bUseSoftReset = false;
+	
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MXFPS|Player")
 	bool bUseRandomPlayerSpawn = false;
 
@@ -141,13 +183,48 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MXFPS|Map")
 	float LevelRadius = 10000.f;
 
+	// The minimum distance between any two of the points that the player and the enemies may be spawned at
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MXFPS|Map", meta = (ClampMin = "1"))
+	float SpawnPointSpacing = 200.f;
+
 private:
 	void EnableAllInputAndMovement();
 	void DisableAllInputAndMovement();
 
-	void LoadSaveGame();
+	void BroadcastGameRunningChanged();
+
+	void HandleScoreTimer();
+	void SetPlayerScore(int32 NewPlayerScore);
+	void UpdateHasNewHighscore();
+
+	void SoftResetGame();
+
+	void HandleEnemyActivated(APawn* Enemy);
+	void HandleEnemyDeactivated(APawn* Enemy);
+	void HandleEnemiesReady();
+
+	void RegisterPawn(APawn* Pawn);
+	void UnregisterPawn(APawn* Pawn);
+
+	void HandleActorSpawned(AActor* Actor);
+
+	UFUNCTION()
+	void HandlePawnEndPlay(AActor* Actor, EEndPlayReason::Type EndPlayReason);
+
+	UFUNCTION()
+	void HandlePawnControllerChanged(APawn* Pawn, AController* OldController, AController* NewController);
+
+	void UpdateHighscore();
+
+	class USpawnPointSubsystem* PrepareSpawnPoints(ARecastNavMesh const* NavMesh) const;
+
+	void SpawnEnemies();
+
+	void HandleSaveGameLoaded(UMXFPSSaveGameData* LoadedSaveGameData);
 	void StoreSaveGame();
 
+	class USaveGameSubsystem* GetSaveGameSubsystem() const;
+
 	static void CacheBestResolutionPerWindowMode();
 
 	UPROPERTY()
@@ -155,12 +232,23 @@ private:
 
 	UPROPERTY()
 	AController* GameOverResponsibleController;
+
+	// Only spawned with bUseRandomPlayerSpawn
+	UPROPERTY()
+	class APlayerStart* RandomPlayerStart = nullptr;
+
+	// Dense, so that enabling or disabling every pawn is a tight loop
+	UPROPERTY()
+	TArray<FMXFPSRegisteredPawn> RegisteredPawnArray;
+	TMap<APawn*, int32> RegisteredPawnIndexMap;
+	FDelegateHandle ActorSpawnedHandle;
 	
+	// Seconds of game time the game has been running for, counted by a timer that is paused along with the game
 	int32 PlayerScore;
-	int32 PlayerScoreOffset; // Used to keep track of PlayerScore between pauses
+	FTimerHandle ScoreTimerHandle;
+	bool bHasNewHighscore;
 
 	FVector PlayerSpawnLocation;
-	FDateTime GameRunningTime;
 	bool bIsGameRunning;
 	bool bIsGamePaused;
 	bool bShouldRestartGame;
@@ -0,0 +1,71 @@
+// Ricardo Santos, 2023
+
+#pragma once
+
+#include <CoreMinimal.h>
+#include <GameFramework/Info.h>
+
+#include "QulockReplicationInfo.generated.h"
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FQulockTargetFrozenChangedEvent, APawn*, Target, bool, bIsFrozen);
+
+// Which Qulock targets are frozen, as evaluated by the server from the view of every connection,
+// so that clients don't evaluate anything themselves; spawned by the server in networked sessions only.
+// Frozen targets go dormant, so neither their movement nor anything else of theirs is replicated until they can move again.
+UCLASS(NotPlaceable)
+class MINDERAXFPS_API AQulockReplicationInfo : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	explicit AQulockReplicationInfo(FObjectInitializer const& ObjectInitializer);
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	virtual void PostInitializeComponents() override;
+
+	virtual void EndPlay(EEndPlayReason::Type const EndPlayReason) override;
+
+	// Server only, cheap enough to call every frame for every target, nothing is replicated unless it changed
+	void SetTargetFrozen(APawn* Target, bool bIsFrozen);
+
+	// Server only
+	void RemoveTarget(APawn* Target);
+
+	// Server only, lets a frozen target that was moved anyway (e.g., teleported by a soft reset) replicate where it is now
+	void NotifyTargetMoved(APawn* Target);
+
+	UFUNCTION(BlueprintPure, Category = "Qulock")
+	bool IsTargetFrozen(APawn const* Target) const;
+
+	// Broadcast on clients only, as the frozen targets are replicated
+	UPROPERTY(BlueprintAssignable, Category = "Qulock")
+	FQulockTargetFrozenChangedEvent OnTargetFrozenChanged;
+
+private:
+	UFUNCTION()
+	void OnRep_FrozenTargets();
+
+	void HandleTargetFrozenChanged(APawn* Target, bool bIsFrozen);
+
+	// One slot per target, which it keeps until it's removed, and is then reused by the next one
+	UPROPERTY(ReplicatedUsing = OnRep_FrozenTargets)
+	TArray<APawn*> TargetSlotArray;
+
+	// Packed, one bit per slot; dynamic arrays are replicated as the elements that changed since the last update
+	// each connection acknowledged, so an update costs a few bytes per target that froze or unfroze, however many there are.
+	UPROPERTY(ReplicatedUsing = OnRep_FrozenTargets)
+	TArray<uint8> FrozenSlotBits;
+
+	// Maintained as the slots are assigned on the server, and as they are replicated on clients
+	UPROPERTY()
+	TMap<APawn*, int32> TargetSlotMap;
+
+	// Server only
+	TArray<int32> FreeSlotArray;
+
+	// Client only, what was replicated last time, so we can tell what changed
+	TArray<TWeakObjectPtr<APawn>> ReceivedTargetSlotArray;
+	TArray<uint8> ReceivedFrozenSlotBits;
+
+};